@@ -1,5 +1,7 @@
 #include <set>
 #include <map>
+#include <vector>
+#include <string>
 #include <iostream>
 
 using namespace std;
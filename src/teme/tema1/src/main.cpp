@@ -69,13 +69,13 @@ int main()
             vector<int> solution = automata.evaluateStringWithPath(word);
             if (!solution.empty())
             {
-                cout << "VALID" << endl;
+                cout << "VALID\n";
                 for (auto value : solution)
                     cout << value << " ";
-                cout << endl;
+                cout << '\n';
             }
             else
-                cout << "INVALID" << endl;
+                cout << "INVALID\n";
         }
         break;
     }
@@ -94,13 +94,13 @@ int main()
             vector<int> solution = automata.evaluateStringWithPath(word);
             if (!solution.empty())
             {
-                cout << "VALID" << endl;
+                cout << "VALID\n";
                 for (auto value : solution)
                     cout << value << " ";
-                cout << endl;
+                cout << '\n';
             }
             else
-                cout << "INVALID" << endl;
+                cout << "INVALID\n";
         }
         break;
     }
@@ -120,16 +120,16 @@ int main()
             vector<vector<int>> solutions = lnfa.evaluateStringWithPath(word);
             if (!solutions.empty())
             {
-                cout << "VALID" << endl;
+                cout << "VALID\n";
                 for (const auto &solution : solutions)
                 {
                     for (auto state : solution)
                         cout << state << " ";
-                    cout << endl;
+                    cout << '\n';
                 }
             }
             else
-                cout << "INVALID" << endl;
+                cout << "INVALID\n";
         }
         break;
     }
@@ -0,0 +1,151 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <istream>
+#include <stdexcept>
+#include <string_view>
+#include "fa.hpp"
+#include "unicode.hpp"
+#include "../../tema3/src/fa.hpp"
+
+using namespace std;
+
+namespace fa
+{
+    // every automaton kind of the library behind one interface. the engine is picked once, when the
+    // automaton is loaded, from its size, determinism, lambda transitions and alphabet, and the choice
+    // is reported together with the reason for it
+    class PlannedAutomata
+    {
+    public:
+        enum class Engine
+        {
+            DenseDFA,
+            BitParallelNFA,
+            LazyDFA,
+            NFASimulation,
+            DeterministicPDA,
+            GeneralPDA,
+            CYK
+        };
+
+        // subsets a finite automaton may grow to before the planner gives up on a full DFA
+        static DeterminizationBudget defaultBudget() { return DeterminizationBudget{1 << 16, 64 << 20}; }
+
+    private:
+        Engine engine = Engine::DenseDFA;
+        string reason;
+        unique_ptr<Matcher> finiteAutomata;
+        unique_ptr<PushdownAutomata<int, char>> pushdownAutomata;
+        unique_ptr<CNFAutomata<char>> grammar;
+
+        void planFinite()
+        {
+            switch (finiteAutomata->getEngine())
+            {
+            case Matcher::Engine::DFA:
+                engine = Engine::DenseDFA;
+                break;
+            case Matcher::Engine::BitParallelNFA:
+                engine = Engine::BitParallelNFA;
+                break;
+            case Matcher::Engine::LazyDFA:
+                engine = Engine::LazyDFA;
+                break;
+            default:
+                engine = Engine::NFASimulation;
+            }
+            reason = finiteAutomata->getReason();
+        }
+
+    public:
+        explicit PlannedAutomata(const DFA &dfa) : finiteAutomata(make_unique<Matcher>(dfa)) { planFinite(); }
+        explicit PlannedAutomata(const NFA &nfa, const DeterminizationBudget &budget = defaultBudget())
+            : finiteAutomata(make_unique<Matcher>(nfa, budget)) { planFinite(); }
+
+        explicit PlannedAutomata(PushdownAutomata<int, char> automata)
+            : pushdownAutomata(make_unique<PushdownAutomata<int, char>>(move(automata)))
+        {
+            if (pushdownAutomata->isDeterministic())
+            {
+                engine = Engine::DeterministicPDA;
+                reason = "no two transitions apply to the same configuration, one pass over a dense transition table";
+            }
+            else
+            {
+                engine = Engine::GeneralPDA;
+                reason = "some configuration has more than one transition, backtracking search";
+            }
+        }
+
+        // a CNF grammar has no lambda rules and no unit rules, which is exactly what the CYK chart needs
+        explicit PlannedAutomata(CNFAutomata<char> automata)
+            : engine(Engine::CYK), reason("grammar in Chomsky normal form"),
+              grammar(make_unique<CNFAutomata<char>>(move(automata))) {}
+
+        // kind is dfa, nfa, cnf or pda, the file formats are the ones of the matching operator>>
+        static PlannedAutomata load(const string &kind, istream &in, const DeterminizationBudget &budget = defaultBudget())
+        {
+            if (kind == "dfa")
+            {
+                DFA automata;
+                in >> automata;
+                return PlannedAutomata(automata);
+            }
+            if (kind == "nfa")
+            {
+                NFA automata;
+                in >> automata;
+                return PlannedAutomata(automata, budget);
+            }
+            if (kind == "cnf")
+            {
+                CNFAutomata<char> automata('0', 'S');
+                in >> automata;
+                return PlannedAutomata(move(automata));
+            }
+            if (kind == "pda")
+            {
+                PushdownAutomata<int, char> automata('0', '$');
+                in >> automata;
+                return PlannedAutomata(move(automata));
+            }
+            throw(runtime_error("Unknown automata kind " + kind + "."));
+        }
+
+        // not const, a lazy DFA extends its cache while matching
+        bool evaluateString(string_view str)
+        {
+            if (finiteAutomata)
+                return finiteAutomata->evaluateString(str);
+            if (pushdownAutomata)
+                return pushdownAutomata->evaluate(vector<char>(str.begin(), str.end()));
+            return grammar->evaluate(vector<char>(str.begin(), str.end()));
+        }
+
+        Engine getEngine() const { return engine; }
+        const string &getReason() const { return reason; }
+
+        friend ostream &operator<<(ostream &out, Engine engine)
+        {
+            switch (engine)
+            {
+            case Engine::DenseDFA:
+                return out << "dense dfa";
+            case Engine::BitParallelNFA:
+                return out << "bit parallel nfa";
+            case Engine::LazyDFA:
+                return out << "lazy dfa";
+            case Engine::NFASimulation:
+                return out << "nfa simulation";
+            case Engine::DeterministicPDA:
+                return out << "deterministic pda";
+            case Engine::GeneralPDA:
+                return out << "general pda";
+            default:
+                return out << "cyk";
+            }
+        }
+    };
+};
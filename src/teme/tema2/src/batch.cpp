@@ -0,0 +1,158 @@
+#include <fstream>
+#include <iostream>
+#include "fa.hpp"
+#include "pipeline.hpp"
+
+using namespace std;
+using namespace fa;
+
+void printUsage(const char *program)
+{
+    cerr << "Usage: " << program << " --automaton <file> --words <file> [options]" << endl;
+    cerr << "  --type dfa|nfa          automata type (default dfa)" << endl;
+    cerr << "  --engine map|dense|batch" << endl;
+    cerr << "                          map: original engine, dense: compiled table, batch: interleaved compiled table" << endl;
+    cerr << "  --threads <count>       evaluation threads, 1 to 1024 (default: hardware concurrency)" << endl;
+    cerr << "  --paths                 print the accepting path(s) as well, the batch engine falls back to dense for this" << endl;
+}
+
+void appendPath(const vector<int> &path, string &output)
+{
+    for (auto state : path)
+        output.append(to_string(state)).push_back(' ');
+    output.push_back('\n');
+}
+
+// a whole positive number of threads, anything past maximumThreads is a typo rather than a request
+bool parseThreadCount(const string &text, unsigned &threadCount)
+{
+    const long maximumThreads = 1024;
+    size_t parsed = 0;
+    long value;
+    try
+    {
+        value = stol(text, &parsed);
+    }
+    catch (const exception &)
+    {
+        return false;
+    }
+    if (parsed != text.size() || value <= 0 || value > maximumThreads)
+        return false;
+    threadCount = value;
+    return true;
+}
+
+int main(int argc, char *argv[])
+{
+    string automataPath, wordsPath, type = "dfa", engine = "dense";
+    unsigned threadCount = thread::hardware_concurrency();
+    bool printPaths = false;
+
+    for (int index = 1; index < argc; index++)
+    {
+        string argument = argv[index];
+        if (argument == "--paths")
+            printPaths = true;
+        else if (index + 1 < argc && argument == "--automaton")
+            automataPath = argv[++index];
+        else if (index + 1 < argc && argument == "--words")
+            wordsPath = argv[++index];
+        else if (index + 1 < argc && argument == "--type")
+            type = argv[++index];
+        else if (index + 1 < argc && argument == "--engine")
+            engine = argv[++index];
+        else if (index + 1 < argc && argument == "--threads")
+        {
+            if (!parseThreadCount(argv[++index], threadCount))
+            {
+                printUsage(argv[0]);
+                return 1;
+            }
+        }
+        else
+        {
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+    if (automataPath.empty() || wordsPath.empty() || (type != "dfa" && type != "nfa") ||
+        (engine != "map" && engine != "dense" && engine != "batch"))
+    {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    ifstream in(automataPath);
+    if (!in)
+    {
+        cerr << "Could not open " << automataPath << endl;
+        return 1;
+    }
+
+    ios::sync_with_stdio(false);
+    MappedFile words(wordsPath);
+    WordPipeline pipeline(threadCount);
+
+    DFA dfa;
+    NFA nfa;
+    if (type == "dfa")
+        in >> dfa;
+    else
+        in >> nfa;
+    // the map engines search transition by transition, without dead states they give up on a word
+    // as soon as it can no longer be accepted
+    dfa.removeDeadStates();
+    nfa.removeDeadStates();
+
+    if (engine == "map" && type == "dfa")
+        pipeline.run(words.getContents(), cout, [&dfa, printPaths](string_view word, string &output)
+                     {
+                         vector<int> solution = dfa.evaluateStringWithPath(string(word));
+                         output.append(solution.empty() ? "INVALID\n" : "VALID\n");
+                         if (printPaths && !solution.empty())
+                             appendPath(solution, output);
+                     });
+    else if (engine == "map")
+        pipeline.run(words.getContents(), cout, [&nfa, printPaths](string_view word, string &output)
+                     {
+                         vector<vector<int>> solutions = nfa.evaluateStringWithPath(string(word));
+                         output.append(solutions.empty() ? "INVALID\n" : "VALID\n");
+                         if (printPaths)
+                             for (const auto &solution : solutions)
+                                 appendPath(solution, output);
+                     });
+    else
+    {
+        // the compiled engines work on a minimized DFA, an NFA is reduced (which also folds
+        // its lambda transitions away) and determinized first. minimization merges states, so
+        // for paths only the unreachable ones are dropped and a DFA keeps the ids of its file
+        DFA deterministic = (type == "dfa") ? dfa : nfa.reduce().turnDeterministic();
+        if (printPaths)
+            deterministic.removeUnreachableStates();
+        else
+            deterministic.minimize();
+        DenseDFA compiled(deterministic);
+        // batch evaluation only answers membership, paths need the word by word walk of the dense engine
+        if (engine == "dense" || printPaths)
+            pipeline.run(words.getContents(), cout, [&compiled, printPaths](string_view word, string &output)
+                         {
+                             if (!printPaths)
+                             {
+                                 output.append(compiled.evaluateString(word) ? "VALID\n" : "INVALID\n");
+                                 return;
+                             }
+                             vector<int> solution = compiled.evaluateStringWithPath(word);
+                             output.append(solution.empty() ? "INVALID\n" : "VALID\n");
+                             if (!solution.empty())
+                                 appendPath(solution, output);
+                         });
+        else
+            pipeline.run(words.getContents(), cout, WordPipeline::ChunkEvaluator([&compiled](const vector<string_view> &chunk, string &output)
+                                                                                 {
+                                                                                     for (bool answer : compiled.evaluateBatch(chunk))
+                                                                                         output.append(answer ? "VALID\n" : "INVALID\n");
+                                                                                 }));
+    }
+    return 0;
+}
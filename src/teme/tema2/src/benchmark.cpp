@@ -0,0 +1,111 @@
+#include <chrono>
+#include <random>
+#include <fstream>
+#include <iostream>
+#include "fa.hpp"
+
+using namespace std;
+using namespace fa;
+
+// usage: benchmark [stateCount] [wordCount] [alphabetSize] [vocabularySize]
+// with a vocabulary the words are drawn from that many distinct words, like tokens of real text,
+// which gives the row layouts a hot set to pack
+int main(int argc, char *argv[])
+{
+    int stateCount = (argc > 1) ? stoi(argv[1]) : 200000;
+    int wordCount = (argc > 2) ? stoi(argv[2]) : 200000;
+    int alphabetSize = (argc > 3) ? stoi(argv[3]) : 16;
+    int vocabularySize = (argc > 4) ? stoi(argv[4]) : 0;
+
+    // random complete DFA, large enough for the table to fall out of cache
+    mt19937 generator(2024);
+    DFA dfa;
+    for (int state = 0; state < stateCount; state++)
+        dfa.addState(state);
+    for (int state = 0; state < stateCount; state++)
+        for (int character = 0; character < alphabetSize; character++)
+            dfa.addTransition(state, generator() % stateCount, (char)('a' + character));
+    for (int state = 0; state < stateCount; state += 3)
+        dfa.addFinalState(state);
+
+    vector<string> words(vocabularySize > 0 ? vocabularySize : wordCount);
+    for (auto &word : words)
+    {
+        word.resize(1 + generator() % 64);
+        for (auto &character : word)
+            character = (char)('a' + generator() % alphabetSize);
+    }
+    if (vocabularySize > 0)
+    {
+        vector<string> vocabulary;
+        vocabulary.swap(words);
+        words.resize(wordCount);
+        for (auto &word : words)
+            word = vocabulary[generator() % vocabulary.size()];
+    }
+
+    DenseDFA compiled(dfa);
+    cout << "States: " << compiled.getStateCount() << ", symbol classes: " << compiled.getClassCount()
+         << ", table: " << compiled.getTableSize() / 1024 << " KiB" << endl;
+
+    auto start = chrono::steady_clock::now();
+    vector<bool> scalarAnswers(words.size());
+    for (size_t index = 0; index < words.size(); index++)
+        scalarAnswers[index] = compiled.evaluateString(words[index]);
+    auto scalarTime = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+
+    start = chrono::steady_clock::now();
+    vector<bool> batchAnswers = compiled.evaluateBatch(words);
+    auto batchTime = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+
+    // the same table with its rows laid out for locality, statically and from a profile of a tenth of the words
+    auto timeLayout = [&words, &scalarAnswers](const DenseDFA &layout, size_t &mismatches)
+    {
+        auto layoutStart = chrono::steady_clock::now();
+        for (size_t index = 0; index < words.size(); index++)
+            if (layout.evaluateString(words[index]) != scalarAnswers[index])
+                mismatches++;
+        return chrono::duration<double, milli>(chrono::steady_clock::now() - layoutStart).count();
+    };
+    size_t layoutMismatches = 0;
+    vector<string> sample(words.begin(), words.begin() + words.size() / 10);
+    auto breadthFirstTime = timeLayout(compiled.reorderStates(DenseDFA::StateOrder::BreadthFirst), layoutMismatches);
+    auto depthFirstTime = timeLayout(compiled.reorderStates(DenseDFA::StateOrder::DepthFirst), layoutMismatches);
+    auto profileTime = timeLayout(compiled.reorderStates(sample), layoutMismatches);
+
+    // Moore minimization of the table on one thread and on every core, both must give the same automata
+    start = chrono::steady_clock::now();
+    DenseDFA serialMinimal = compiled.minimize(1);
+    auto serialMinimizeTime = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+    unsigned threadCount = max(1u, thread::hardware_concurrency());
+    start = chrono::steady_clock::now();
+    DenseDFA parallelMinimal = compiled.minimize(threadCount);
+    auto parallelMinimizeTime = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+    if (serialMinimal.getStateCount() != parallelMinimal.getStateCount())
+        layoutMismatches++;
+
+    // the original map based engine, on a sample since it is much slower
+    size_t sampleSize = min(words.size(), (size_t)10000);
+    start = chrono::steady_clock::now();
+    size_t mismatches = 0;
+    for (size_t index = 0; index < sampleSize; index++)
+        if (dfa.evaluateString(words[index]) != scalarAnswers[index])
+            mismatches++;
+    auto mapTime = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count() * words.size() / sampleSize;
+
+    for (size_t index = 0; index < words.size(); index++)
+        if (scalarAnswers[index] != batchAnswers[index])
+            mismatches++;
+    mismatches += layoutMismatches;
+
+    cout << "DFA::evaluateString (extrapolated): " << mapTime << " ms" << endl;
+    cout << "DenseDFA::evaluateString: " << scalarTime << " ms" << endl;
+    cout << "DenseDFA::evaluateBatch: " << batchTime << " ms" << endl;
+    cout << "DenseDFA::evaluateString, breadth first rows: " << breadthFirstTime << " ms" << endl;
+    cout << "DenseDFA::evaluateString, depth first rows: " << depthFirstTime << " ms" << endl;
+    cout << "DenseDFA::evaluateString, profile guided rows: " << profileTime << " ms" << endl;
+    cout << "DenseDFA::minimize, 1 thread: " << serialMinimizeTime << " ms, " << serialMinimal.getStateCount() << " states" << endl;
+    cout << "DenseDFA::minimize, " << threadCount << " threads: " << parallelMinimizeTime << " ms" << endl;
+    cout << "Mismatches: " << mismatches << endl;
+    return mismatches != 0;
+}
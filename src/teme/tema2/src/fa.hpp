@@ -1,11 +1,44 @@
+#pragma once
+
 #include <set>
 #include <map>
+#include <array>
+#include <cstdint>
 #include <queue>
+#include <deque>
+#include <vector>
+#include <memory>
+#include <memory_resource>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
 #include <iostream>
 #include <algorithm>
+#include <functional>
+#include <stdexcept>
 
 using namespace std;
 
+#if defined(__GNUC__) || defined(__clang__)
+#define FA_PREFETCH(address) __builtin_prefetch(address)
+#define FA_LOWEST_BIT(mask) __builtin_ctzll(mask)
+#else
+#define FA_PREFETCH(address)
+#define FA_LOWEST_BIT(mask) faLowestBit(mask)
+// index of the lowest set bit, the mask is never zero
+inline int faLowestBit(uint64_t mask)
+{
+    int bit = 0;
+    while (!(mask & 1))
+    {
+        mask >>= 1;
+        bit++;
+    }
+    return bit;
+}
+#endif
+
 namespace fa
 {
     template <typename StateType, typename TransitionType>
@@ -27,7 +60,7 @@ namespace fa
                 ok = true;
                 solutionPath = currentPath;
             }
-            else
+            else if (depth < (int)word.size())
             {
                 auto itt = transitions.find(currentState);
                 if (itt != transitions.end())
@@ -119,11 +152,67 @@ namespace fa
             return answer;
         }
 
+        // states from which no final state can be reached, any run entering one of them can only reject
+        set<StateType> getDeadStates() const
+        {
+            map<StateType, vector<StateType>> predecessors;
+            for (auto itt = transitions.begin(); itt != transitions.end(); itt++)
+                for (auto it = (itt->second).begin(); it != (itt->second).end(); it++)
+                    predecessors[it->first].push_back(itt->first);
+
+            set<StateType> coReachable(finalStates.begin(), finalStates.end());
+            vector<StateType> stateStack(finalStates.begin(), finalStates.end());
+            while (!stateStack.empty())
+            {
+                StateType state = stateStack.back();
+                stateStack.pop_back();
+                auto itp = predecessors.find(state);
+                if (itp != predecessors.end())
+                    for (const auto &predecessor : itp->second)
+                        if (coReachable.insert(predecessor).second)
+                            stateStack.push_back(predecessor);
+            }
+
+            set<StateType> deadStates;
+            for (auto its = states.begin(); its != states.end(); its++)
+                if (coReachable.find(*its) == coReachable.end())
+                    deadStates.insert(*its);
+            return deadStates;
+        }
+
+        // drops dead states with every transition into or out of them so the searches never enter
+        // a branch that can only fail, the initial state is kept even when it is dead
+        void removeDeadStates()
+        {
+            set<StateType> deadStates = getDeadStates();
+            for (auto itd = deadStates.begin(); itd != deadStates.end(); itd++)
+            {
+                transitions.erase(*itd);
+                if (*itd != initialState)
+                    states.erase(*itd);
+            }
+            for (auto itt = transitions.begin(); itt != transitions.end();)
+            {
+                for (auto it = (itt->second).begin(); it != (itt->second).end();)
+                    if (deadStates.find(it->first) != deadStates.end())
+                        it = (itt->second).erase(it);
+                    else
+                        it++;
+                if ((itt->second).empty())
+                    itt = transitions.erase(itt);
+                else
+                    itt++;
+            }
+        }
+
         set<StateType> getStates() const { return states; }
+        const set<StateType> &getStateSet() const { return states; }
         void addState(StateType newState) { states.insert(newState); }
-        void setStates(set<StateType> states) { states = states; }
+        void setStates(set<StateType> states) { this->states = states; }
 
         map<StateType, map<StateType, set<TransitionType>>> getTransitiions() const { return transitions; }
+        // read only view for compilers that only walk the table once, without copying it
+        const map<StateType, map<StateType, set<TransitionType>>> &getTransitionTable() const { return transitions; }
         void addTransition(StateType startState, StateType endState, TransitionType character)
         {
             if (states.find(startState) == states.end())
@@ -145,115 +234,152 @@ namespace fa
                     transitions[startState][endState].insert(character);
             }
         }
-        void setTransitions(map<StateType, map<StateType, set<TransitionType>>> transitions) { transitions = transitions; }
+        void setTransitions(map<StateType, map<StateType, set<TransitionType>>> transitions) { this->transitions = transitions; }
 
         StateType getInitialState() const { return initialState; }
-        void setInitialState(StateType initialState) { initialState = initialState; }
+        void setInitialState(StateType initialState) { this->initialState = initialState; }
 
         set<StateType> getFinalStates() const { return finalStates; }
         void addFinalState(StateType newState) { finalStates.insert(newState); }
-        void setFinalStates(set<StateType> finalStates) { finalStates = finalStates; }
+        void setFinalStates(set<StateType> finalStates) { this->finalStates = finalStates; }
 
         TransitionType getLambdaCharacter() const { return lambdaCharacter; }
-        void setLambdaCharacter(TransitionType lambdaCharacter) { lambdaCharacter = lambdaCharacter; }
+        void setLambdaCharacter(TransitionType lambdaCharacter) { this->lambdaCharacter = lambdaCharacter; }
 
         vector<TransitionType> getLambdaString() const { return lambdaString; }
-        void setLambdaString(vector<TransitionType> lambdaString) { lambdaString = lambdaString; }
+        void setLambdaString(vector<TransitionType> lambdaString) { this->lambdaString = lambdaString; }
+
+        // rough heap footprint, every tree node pays for three pointers, a color word and the allocator header
+        static size_t treeNodeSize(size_t valueSize) { return (32 + valueSize + 8 + 15) / 16 * 16; }
+        size_t memoryUsage() const
+        {
+            size_t usage = sizeof(*this) + lambdaString.capacity() * sizeof(TransitionType);
+            usage += (states.size() + finalStates.size()) * treeNodeSize(sizeof(StateType));
+            for (auto itt = transitions.begin(); itt != transitions.end(); itt++)
+            {
+                usage += treeNodeSize(sizeof(*itt));
+                for (auto it = (itt->second).begin(); it != (itt->second).end(); it++)
+                    usage += treeNodeSize(sizeof(*it)) + (it->second).size() * treeNodeSize(sizeof(TransitionType));
+            }
+            return usage;
+        }
     };
 
     class DFA : public FA<int, char>
     {
-    private:
+    public:
+        // first half of minimize, the states that are left keep their names
         void removeUnreachableStates()
         {
             // remove unreachable states
             // alternatively, consider DFA as NFA and call turnDeterministic
-            set<int> reachableStates{initialState};
-            set<int> newStates{initialState};
+            // temporaries live in one arena that is released when the function returns
+            pmr::monotonic_buffer_resource arena;
+            pmr::set<int> reachableStates({initialState}, &arena);
+            pmr::vector<int> newStates({initialState}, &arena);
 
             while (!newStates.empty())
             {
-                set<int> tmp;
-                for (auto it = newStates.begin(); it != newStates.end(); it++)
-                    for (auto itt = transitions[*it].begin(); itt != transitions[*it].end(); itt++)
-                        tmp.insert(itt->first);
-
-                newStates.clear();
-                set_difference(tmp.begin(), tmp.end(), reachableStates.begin(), reachableStates.end(),
-                               inserter(newStates, newStates.end()));
+                int currentState = newStates.back();
+                newStates.pop_back();
 
-                reachableStates.insert(newStates.begin(), newStates.end());
+                auto itt = transitions.find(currentState);
+                if (itt == transitions.end())
+                    continue;
+                for (auto it = (itt->second).begin(); it != (itt->second).end(); it++)
+                    if (reachableStates.insert(it->first).second)
+                        newStates.push_back(it->first);
             }
 
-            // delete all unreachable states and their transitions
-            set<int> unreachableStates;
-            for (auto it = states.begin(); it != states.end(); it++)
-                if (reachableStates.find(*it) == reachableStates.end())
-                    unreachableStates.insert(*it);
-
-            map<int, map<int, set<char>>> transitionsTmp = transitions;
-            for (auto itt = transitions.begin(); itt != transitions.end(); itt++)
+            // delete all unreachable states and their transitions in place
+            for (auto itt = transitions.begin(); itt != transitions.end();)
             {
-                if (unreachableStates.find(itt->first) != unreachableStates.end())
+                if (reachableStates.find(itt->first) == reachableStates.end())
                 {
-                    transitionsTmp.erase(itt->first);
+                    itt = transitions.erase(itt);
                     continue;
                 }
-                for (auto it = (itt->second).begin(); it != (itt->second).end(); it++)
-                    if (unreachableStates.find(it->first) != unreachableStates.end())
-                        transitionsTmp[itt->first].erase(it->first);
+                for (auto it = (itt->second).begin(); it != (itt->second).end();)
+                    if (reachableStates.find(it->first) == reachableStates.end())
+                        it = (itt->second).erase(it);
+                    else
+                        it++;
+                itt++;
             }
 
-            states = reachableStates;
-            transitions = transitionsTmp;
+            for (auto its = states.begin(); its != states.end();)
+                if (reachableStates.find(*its) == reachableStates.end())
+                    its = states.erase(its);
+                else
+                    its++;
+            for (auto itf = finalStates.begin(); itf != finalStates.end();)
+                if (reachableStates.find(*itf) == reachableStates.end())
+                    itf = finalStates.erase(itf);
+                else
+                    itf++;
         }
+
+    private:
         void removeIndistinguishableStates()
         {
             // this is an implementation of Hopcroft's algorithm
-            set<int> nonFinalStates;
+            // partitions are split and discarded all the time, so a pool recycles their nodes
+            // and the arena underneath hands everything back in one shot at the end
+            pmr::monotonic_buffer_resource arena;
+            pmr::unsynchronized_pool_resource pool(&arena);
+
+            pmr::set<int> finalPartition(finalStates.begin(), finalStates.end(), &pool);
+            pmr::set<int> nonFinalPartition(&pool);
             set_difference(states.begin(), states.end(), finalStates.begin(), finalStates.end(),
-                           inserter(nonFinalStates, nonFinalStates.end()));
+                           inserter(nonFinalPartition, nonFinalPartition.end()));
 
-            set<set<int>> partitions{finalStates, nonFinalStates};
-            set<set<int>> setQueue{finalStates, nonFinalStates};
+            pmr::set<pmr::set<int>> partitions(&pool);
+            pmr::set<pmr::set<int>> setQueue(&pool);
+            for (const auto *partition : {&finalPartition, &nonFinalPartition})
+                if (!partition->empty())
+                {
+                    partitions.insert(*partition);
+                    setQueue.insert(*partition);
+                }
 
             while (!setQueue.empty())
             {
-                set<int> currentSet = *setQueue.begin();
-                setQueue.erase(setQueue.begin());
+                auto currentSetNode = setQueue.extract(setQueue.begin());
+                const pmr::set<int> &currentSet = currentSetNode.value();
 
-                map<char, set<int>> inboundTransitions;
+                pmr::map<char, pmr::set<int>> inboundTransitions(&pool);
                 for (auto itt = transitions.begin(); itt != transitions.end(); itt++)
                     for (auto it = (itt->second).begin(); it != (itt->second).end(); it++)
                         if (currentSet.find(it->first) != currentSet.end())
                             for (auto itc = (it->second).begin(); itc != (it->second).end(); itc++)
-                            {
-                                if (inboundTransitions.find(*itc) == inboundTransitions.end())
-                                    inboundTransitions.insert(pair<char, set<int>>(*itc, set<int>{itt->first}));
-                                else
-                                    inboundTransitions[*itc].insert(itt->first);
-                            }
+                                inboundTransitions[*itc].insert(itt->first);
 
-                set<set<int>> partitionsTmp = partitions;
+                // every character refines the partitions left by the previous one,
+                // unchanged partitions are moved over without copying their nodes
                 for (auto itt = inboundTransitions.begin(); itt != inboundTransitions.end(); itt++)
-                    for (auto itp = partitions.begin(); itp != partitions.end(); itp++)
+                {
+                    pmr::set<pmr::set<int>> refinedPartitions(&pool);
+                    while (!partitions.empty())
                     {
-                        set<int> intersection, difference;
-                        set_intersection((itt->second).begin(), (itt->second).end(), (*itp).begin(), (*itp).end(),
+                        auto partitionNode = partitions.extract(partitions.begin());
+                        const pmr::set<int> &partition = partitionNode.value();
+
+                        pmr::set<int> intersection(&pool), difference(&pool);
+                        set_intersection((itt->second).begin(), (itt->second).end(), partition.begin(), partition.end(),
                                          inserter(intersection, intersection.end()));
-                        set_difference((*itp).begin(), (*itp).end(), (itt->second).begin(), (itt->second).end(),
+                        set_difference(partition.begin(), partition.end(), (itt->second).begin(), (itt->second).end(),
                                        inserter(difference, difference.end()));
 
                         if (intersection.empty() || difference.empty())
+                        {
+                            refinedPartitions.insert(move(partitionNode));
                             continue;
+                        }
 
-                        partitionsTmp.erase(*itp);
-                        partitionsTmp.insert(intersection);
-                        partitionsTmp.insert(difference);
-
-                        if (setQueue.find(*itp) != setQueue.end())
+                        auto itq = setQueue.find(partition);
+                        if (itq != setQueue.end())
                         {
-                            setQueue.erase(*itp);
+                            setQueue.erase(itq);
                             setQueue.insert(intersection);
                             setQueue.insert(difference);
                         }
@@ -264,11 +390,14 @@ namespace fa
                             else
                                 setQueue.insert(difference);
                         }
+                        refinedPartitions.insert(move(intersection));
+                        refinedPartitions.insert(move(difference));
                     }
-                partitions = partitionsTmp;
+                    partitions.swap(refinedPartitions);
+                }
             }
 
-            map<int, int> stateEncoding;
+            pmr::map<int, int> stateEncoding(&arena);
             int encodingIndex = 0;
             for (auto itp = partitions.begin(); itp != partitions.end(); itp++)
             {
@@ -279,6 +408,8 @@ namespace fa
 
             DFA dfa;
             dfa.setInitialState(stateEncoding[initialState]);
+            dfa.setLambdaCharacter(lambdaCharacter);
+            dfa.setLambdaString(lambdaString);
             for (auto it = finalStates.begin(); it != finalStates.end(); it++)
                 dfa.addFinalState(stateEncoding[*it]);
             for (int stateIndex = 0; stateIndex < encodingIndex; stateIndex++)
@@ -312,160 +443,2867 @@ namespace fa
         }
     };
 
-    class NFA : public FA<int, char>
+    class IncrementalDFA
     {
-    protected:
-        void DFS(bool &ok, int depth, const vector<char> &word, int currentState, vector<vector<pair<int, char>>> &solutionPaths,
-                 vector<pair<int, char>> &currentPath, set<int> &lambdaStates) const
+    private:
+        // finality and (character, successor block) pairs, transitions into the dead block are left out
+        typedef pair<bool, vector<pair<char, int>>> Signature;
+        typedef pair<bool, vector<char>> Shape;
+        static const int deadBlock = -1;
+
+        set<int> states;
+        set<int> finalStates;
+        int initialState = 0;
+        map<int, map<char, int>> transitions;
+        // target -> source -> number of characters
+        map<int, map<int, int>> predecessors;
+
+        // state equivalence relation, every state belongs to a block or to the dead block
+        map<int, int> blockOf;
+        map<int, set<int>> blockMembers;
+        map<int, Signature> blockSignature;
+        map<Signature, int> blockBySignature;
+        map<Shape, set<int>> blocksByShape;
+        // (character, successor block) -> blocks with that transition
+        map<pair<char, int>, set<int>> blocksByTransition;
+        int nextBlock = 0;
+        int affectedStateCount = 0;
+
+        static Shape shapeOf(const Signature &signature)
         {
-            if (depth == word.size() && finalStates.find(currentState) != finalStates.end())
+            Shape shape(signature.first, vector<char>());
+            for (const auto &transition : signature.second)
+                shape.second.push_back(transition.first);
+            return shape;
+        }
+
+        void addBlock(int block, const Signature &signature)
+        {
+            blockSignature[block] = signature;
+            blockBySignature[signature] = block;
+            blocksByShape[shapeOf(signature)].insert(block);
+            for (const auto &transition : signature.second)
+                blocksByTransition[transition].insert(block);
+        }
+        void removeBlock(int block)
+        {
+            const Signature &signature = blockSignature[block];
+            blockBySignature.erase(signature);
+            blocksByShape[shapeOf(signature)].erase(block);
+            for (const auto &transition : signature.second)
             {
-                ok = true;
-                solutionPaths.emplace_back(currentPath);
+                auto itb = blocksByTransition.find(transition);
+                itb->second.erase(block);
+                if (itb->second.empty())
+                    blocksByTransition.erase(itb);
             }
-            else
+            blockSignature.erase(block);
+            blockMembers.erase(block);
+        }
+
+        // recomputes the blocks of every state that can reach one of the changed states,
+        // the languages of all other states are unchanged and so are their blocks
+        void refresh(const vector<int> &changedStates)
+        {
+            set<int> affected;
+            vector<int> stateStack;
+            for (auto state : changedStates)
+                if (states.find(state) != states.end() && affected.insert(state).second)
+                    stateStack.push_back(state);
+            while (!stateStack.empty())
             {
-                auto itt = transitions.find(currentState);
+                int state = stateStack.back();
+                stateStack.pop_back();
+                auto itp = predecessors.find(state);
+                if (itp != predecessors.end())
+                    for (const auto &predecessor : itp->second)
+                        if (affected.insert(predecessor.first).second)
+                            stateStack.push_back(predecessor.first);
+            }
+            affectedStateCount = affected.size();
+
+            // detach the affected states, blocks left without members are dropped
+            for (auto state : affected)
+            {
+                auto itb = blockOf.find(state);
+                if (itb == blockOf.end() || itb->second == deadBlock)
+                    continue;
+                blockMembers[itb->second].erase(state);
+                if (blockMembers[itb->second].empty())
+                    removeBlock(itb->second);
+            }
+
+            // states that cannot reach a final state go to the dead block
+            set<int> live;
+            for (auto state : affected)
+            {
+                bool isLive = finalStates.find(state) != finalStates.end();
+                auto itt = transitions.find(state);
+                if (!isLive && itt != transitions.end())
+                    for (const auto &transition : itt->second)
+                        if (affected.find(transition.second) == affected.end() && blockOf[transition.second] != deadBlock)
+                            isLive = true;
+                if (isLive && live.insert(state).second)
+                    stateStack.push_back(state);
+            }
+            while (!stateStack.empty())
+            {
+                int state = stateStack.back();
+                stateStack.pop_back();
+                auto itp = predecessors.find(state);
+                if (itp != predecessors.end())
+                    for (const auto &predecessor : itp->second)
+                        if (affected.find(predecessor.first) != affected.end() && live.insert(predecessor.first).second)
+                            stateStack.push_back(predecessor.first);
+            }
+            for (auto state : affected)
+                if (live.find(state) == live.end())
+                    blockOf[state] = deadBlock;
+
+            // live affected state -> class among the pending states, or the existing block it turned out to join
+            map<int, int> stateClass, resolvedBlock;
+            set<int> pending = live;
+
+            // existing blocks keep their ids, pending classes are encoded as -2 - class
+            auto labelOf = [&](int state) -> int
+            {
+                if (affected.find(state) == affected.end() || live.find(state) == live.end())
+                    return blockOf[state];
+                auto itr = resolvedBlock.find(state);
+                if (itr != resolvedBlock.end())
+                    return itr->second;
+                return -2 - stateClass[state];
+            };
+            auto signatureOf = [&](int state) -> Signature
+            {
+                Signature signature(finalStates.find(state) != finalStates.end(), vector<pair<char, int>>());
+                auto itt = transitions.find(state);
                 if (itt != transitions.end())
-                    for (auto it = (itt->second).begin(); it != (itt->second).end(); it++)
+                    for (const auto &transition : itt->second)
                     {
-                        if ((it->second).find(lambdaCharacter) != (it->second).end() && lambdaStates.find(it->first) == lambdaStates.end())
+                        int label = labelOf(transition.second);
+                        if (label != deadBlock)
+                            signature.second.emplace_back(transition.first, label);
+                    }
+                return signature;
+            };
+
+            int classCount = 0;
+            map<int, Signature> classSignature;
+            while (true)
+            {
+                // Moore refinement of the pending states, starting from final / non final
+                classCount = 0;
+                for (auto state : pending)
+                    stateClass[state] = (finalStates.find(state) != finalStates.end()) ? 1 : 0;
+                int previousCount = -1;
+                while (true)
+                {
+                    map<Signature, int> classEncoding;
+                    map<int, int> nextClass;
+                    for (auto state : pending)
+                        nextClass[state] = classEncoding.insert(pair<Signature, int>(signatureOf(state), classEncoding.size())).first->second;
+                    stateClass = nextClass;
+                    classCount = classEncoding.size();
+                    if (classCount == previousCount)
+                        break;
+                    previousCount = classCount;
+                }
+
+                map<int, vector<int>> classMembers;
+                for (auto state : pending)
+                    classMembers[stateClass[state]].push_back(state);
+                classSignature.clear();
+                for (const auto &members : classMembers)
+                    classSignature[members.first] = signatureOf(members.second.front());
+
+                // a pending class can still be equivalent to an existing block, either directly by signature
+                // or through a cycle of pending classes, which is checked by walking both in lockstep
+                map<int, int> assumed;
+                function<bool(int, int)> equivalentToBlock = [&](int currentClass, int block) -> bool
+                {
+                    auto ita = assumed.find(currentClass);
+                    if (ita != assumed.end())
+                        return ita->second == block;
+                    assumed[currentClass] = block;
+
+                    const Signature &classSig = classSignature[currentClass];
+                    const Signature &blockSig = blockSignature[block];
+                    if (classSig.first != blockSig.first || classSig.second.size() != blockSig.second.size())
+                        return false;
+                    for (size_t index = 0; index < classSig.second.size(); index++)
+                    {
+                        if (classSig.second[index].first != blockSig.second[index].first)
+                            return false;
+                        int label = classSig.second[index].second;
+                        if (label >= 0 && label != blockSig.second[index].second)
+                            return false;
+                        if (label < deadBlock && !equivalentToBlock(-2 - label, blockSig.second[index].second))
+                            return false;
+                    }
+                    return true;
+                };
+
+                bool progress = false;
+                const set<int> noBlocks;
+                for (const auto &members : classMembers)
+                {
+                    if (resolvedBlock.find(members.second.front()) != resolvedBlock.end())
+                        continue;
+                    const Signature &signature = classSignature[members.first];
+
+                    // without pending labels the signature is final and an equivalent block has exactly the same one
+                    bool fixed = all_of(signature.second.begin(), signature.second.end(), [](const pair<char, int> &transition)
+                                        { return transition.second >= 0; });
+                    if (fixed)
+                    {
+                        auto itb = blockBySignature.find(signature);
+                        if (itb != blockBySignature.end())
                         {
-                            lambdaStates.insert(it->first);
-                            currentPath.emplace_back(pair<int, char>(it->first, lambdaCharacter));
-                            DFS(ok, depth, word, it->first, solutionPaths, currentPath, lambdaStates);
-                            currentPath.pop_back();
+                            for (auto state : members.second)
+                                resolvedBlock[state] = itb->second;
+                            progress = true;
                         }
-                        if ((it->second).find(word[depth]) != (it->second).end())
+                        continue;
+                    }
+
+                    // an equivalent block shares every fixed transition, so only the blocks having the rarest of
+                    // them are walked, the blocks of the same shape only when every transition is pending
+                    const set<int> *candidates = nullptr;
+                    for (const auto &transition : signature.second)
+                        if (transition.second >= 0)
                         {
-                            currentPath.emplace_back(pair<int, char>(it->first, word[depth]));
-                            DFS(ok, depth + 1, word, it->first, solutionPaths, currentPath, lambdaStates);
-                            currentPath.pop_back();
+                            auto itc = blocksByTransition.find(transition);
+                            const set<int> &blocks = (itc != blocksByTransition.end()) ? itc->second : noBlocks;
+                            if (!candidates || blocks.size() < candidates->size())
+                                candidates = &blocks;
                         }
+                    if (!candidates)
+                    {
+                        auto its = blocksByShape.find(shapeOf(signature));
+                        candidates = (its != blocksByShape.end()) ? &its->second : &noBlocks;
                     }
+                    for (auto block : *candidates)
+                    {
+                        assumed.clear();
+                        if (!equivalentToBlock(members.first, block))
+                            continue;
+                        for (const auto &match : assumed)
+                            for (auto state : classMembers[match.first])
+                                resolvedBlock[state] = match.second;
+                        progress = true;
+                        break;
+                    }
+                }
+                if (!progress)
+                    break;
+
+                // resolved states become fixed labels, refine the rest again with them
+                for (const auto &resolved : resolvedBlock)
+                    pending.erase(resolved.first);
+            }
+
+            for (const auto &resolved : resolvedBlock)
+            {
+                blockOf[resolved.first] = resolved.second;
+                blockMembers[resolved.second].insert(resolved.first);
+            }
+
+            // whatever is left forms new blocks
+            map<int, int> classBlock;
+            for (auto state : pending)
+            {
+                auto itc = classBlock.find(stateClass[state]);
+                if (itc == classBlock.end())
+                    itc = classBlock.insert(pair<int, int>(stateClass[state], nextBlock++)).first;
+                blockOf[state] = itc->second;
+                blockMembers[itc->second].insert(state);
+            }
+            for (const auto &block : classBlock)
+            {
+                Signature signature = classSignature[block.first];
+                for (auto &transition : signature.second)
+                    if (transition.second < deadBlock)
+                        transition.second = classBlock[-2 - transition.second];
+                addBlock(block.second, signature);
             }
         }
 
     public:
-        NFA(int initialState = 0, char lambdaCharacter = '0', string lambdaString = "-")
-            : FA<int, char>(initialState, lambdaCharacter, vector<char>(lambdaString.begin(), lambdaString.end())) {}
-
-        bool evaluateString(const string &str) const
+        IncrementalDFA() = default;
+        explicit IncrementalDFA(const DFA &dfa) : states(dfa.getStates()), finalStates(dfa.getFinalStates()), initialState(dfa.getInitialState())
         {
-            vector<char> strVector(str.begin(), str.end());
-            if (strVector == lambdaString)
-                return (finalStates.find(initialState) != finalStates.end());
+            map<int, map<int, set<char>>> dfaTransitions = dfa.getTransitiions();
+            for (auto itt = dfaTransitions.begin(); itt != dfaTransitions.end(); itt++)
+                for (auto it = (itt->second).begin(); it != (itt->second).end(); it++)
+                    for (auto itc = (it->second).begin(); itc != (it->second).end(); itc++)
+                    {
+                        if (transitions[itt->first].find(*itc) != transitions[itt->first].end())
+                            throw(runtime_error("Automata is not deterministic."));
+                        transitions[itt->first][*itc] = it->first;
+                        predecessors[it->first][itt->first]++;
+                    }
+            refresh(vector<int>(states.begin(), states.end()));
+        }
 
-            bool ok = false;
-            vector<pair<int, char>> current;
-            vector<vector<pair<int, char>>> solutions;
-            set<int> lambda;
-            DFS(ok, 0, vector<char>(str.begin(), str.end()), initialState, solutions, current, lambda);
-            return ok;
+        void addState(int newState)
+        {
+            if (states.insert(newState).second)
+                blockOf[newState] = deadBlock;
+        }
+        void addFinalState(int newState)
+        {
+            if (states.find(newState) == states.end())
+                throw(runtime_error("Could not find state."));
+            if (finalStates.insert(newState).second)
+                refresh(vector<int>{newState});
         }
+        // replaces the transition on the same character, if there is one
+        void addTransition(int startState, int endState, char character)
+        {
+            if (states.find(startState) == states.end())
+                throw(runtime_error("Could not find start state."));
+            if (states.find(endState) == states.end())
+                throw(runtime_error("Could not find end state."));
 
-        vector<vector<int>> evaluateStringWithPath(const string &str) const
+            auto itt = transitions[startState].find(character);
+            if (itt != transitions[startState].end())
+            {
+                if (itt->second == endState)
+                    return;
+                if (--predecessors[itt->second][startState] == 0)
+                    predecessors[itt->second].erase(startState);
+            }
+            transitions[startState][character] = endState;
+            predecessors[endState][startState]++;
+            refresh(vector<int>{startState});
+        }
+        void removeTransition(int startState, char character)
         {
-            vector<char> strVector(str.begin(), str.end());
-            vector<vector<int>> answer;
-            if (strVector == lambdaString)
-                return (finalStates.find(initialState) != finalStates.end()) ? vector<vector<int>>{
-                                                                                   vector<int>{initialState}}
-                                                                             : vector<vector<int>>{};
+            auto itt = transitions.find(startState);
+            if (itt == transitions.end() || (itt->second).find(character) == (itt->second).end())
+                return;
+            int endState = (itt->second)[character];
+            (itt->second).erase(character);
+            if (--predecessors[endState][startState] == 0)
+                predecessors[endState].erase(startState);
+            refresh(vector<int>{startState});
+        }
+        void setInitialState(int initialState)
+        {
+            if (states.find(initialState) == states.end())
+                throw(runtime_error("Could not find state."));
+            this->initialState = initialState;
+        }
 
-            bool ok = false;
-            vector<pair<int, char>> current;
-            vector<vector<pair<int, char>>> solutions;
-            set<int> lambda;
-            DFS(ok, 0, strVector, initialState, solutions, current, lambda);
-            if (!ok)
-                return answer;
+        bool areEquivalent(int firstState, int secondState) const { return blockOf.at(firstState) == blockOf.at(secondState); }
+        int getBlock(int state) const { return blockOf.at(state); }
+        // number of states whose block was recomputed by the last edit
+        int getAffectedStateCount() const { return affectedStateCount; }
 
-            for (const auto &solution : solutions)
+        // the minimal DFA is read off the blocks reachable from the initial one
+        DFA getMinimal() const
+        {
+            DFA dfa;
+            dfa.addState(0);
+            dfa.setInitialState(0);
+            auto iti = blockOf.find(initialState);
+            if (iti == blockOf.end() || iti->second == deadBlock)
+                return dfa;
+
+            map<int, int> blockEncoding{{iti->second, 0}};
+            queue<int> blockQueue;
+            blockQueue.push(iti->second);
+            while (!blockQueue.empty())
             {
-                vector<int> path{initialState};
-                for (auto transition : solution)
-                    path.emplace_back(transition.first);
-                answer.emplace_back(path);
+                int block = blockQueue.front();
+                blockQueue.pop();
+                const Signature &signature = blockSignature.at(block);
+                if (signature.first)
+                    dfa.addFinalState(blockEncoding[block]);
+                for (const auto &transition : signature.second)
+                {
+                    if (blockEncoding.find(transition.second) == blockEncoding.end())
+                    {
+                        int encodingIndex = blockEncoding.size();
+                        blockEncoding[transition.second] = encodingIndex;
+                        dfa.addState(encodingIndex);
+                        blockQueue.push(transition.second);
+                    }
+                    dfa.addTransition(blockEncoding[block], blockEncoding[transition.second], transition.first);
+                }
             }
-
-            return answer;
+            return dfa;
         }
+    };
+
+    class DenseDFA
+    {
+    private:
+        // byte -> symbol class, bytes that behave identically in every state share a class
+        array<unsigned char, 256> symbolClass{};
+        int classCount = 1;
+        int stateCount = 0;
+        int initialState = 0;
+        // extra row appended after the real states, every missing transition ends up here
+        int deadState = 0;
+        // state x symbol class transition table
+        vector<int> table;
+        vector<char> finalStates;
+        // dense index -> original state
+        vector<int> stateNames;
+        vector<char> lambdaString;
 
-        DFA turnDeterministic() const
+        void computeSymbolClasses(const map<int, map<int, set<char>>> &transitions)
         {
-            DFA automata;
+            // start with a single class and split it by every (state, target) group of characters,
+            // since all characters of a group lead to the same state they can never be told apart by it
+            array<int, 256> classSize{}, hitCount{}, splitClass{};
+            classSize[0] = 256;
+            symbolClass.fill(0);
+            classCount = 1;
 
-            // build nondeterministic finite automata transition table
-            // state, character -> state set
-            map<int, map<char, set<int>>> nondeterministicTransitionTable;
             for (auto itt = transitions.begin(); itt != transitions.end(); itt++)
-            {
-                nondeterministicTransitionTable.insert(pair<int, map<char, set<int>>>(itt->first, map<char, set<int>>()));
                 for (auto it = (itt->second).begin(); it != (itt->second).end(); it++)
+                {
+                    vector<int> touchedClasses;
                     for (auto itc = (it->second).begin(); itc != (it->second).end(); itc++)
-                        if (nondeterministicTransitionTable[itt->first].find(*itc) == nondeterministicTransitionTable[itt->first].end())
-                            nondeterministicTransitionTable[itt->first].insert(pair<char, set<int>>(*itc, set<int>{it->first}));
-                        else
-                            nondeterministicTransitionTable[itt->first][*itc].insert(it->first);
+                    {
+                        int currentClass = symbolClass[(unsigned char)*itc];
+                        if (hitCount[currentClass]++ == 0)
+                            touchedClasses.push_back(currentClass);
+                    }
+                    for (auto currentClass : touchedClasses)
+                        splitClass[currentClass] = (hitCount[currentClass] < classSize[currentClass]) ? classCount++ : currentClass;
+                    for (auto itc = (it->second).begin(); itc != (it->second).end(); itc++)
+                    {
+                        unsigned char character = *itc;
+                        int currentClass = symbolClass[character];
+                        if (splitClass[currentClass] != currentClass)
+                        {
+                            classSize[currentClass]--;
+                            classSize[splitClass[currentClass]]++;
+                            symbolClass[character] = splitClass[currentClass];
+                        }
+                    }
+                    for (auto currentClass : touchedClasses)
+                        hitCount[currentClass] = 0;
+                }
+
+            // renumber classes in order of their first byte so the mapping doesn't depend on transition order
+            array<int, 256> classEncoding;
+            classEncoding.fill(-1);
+            int encodingIndex = 0;
+            for (int character = 0; character < 256; character++)
+            {
+                if (classEncoding[symbolClass[character]] == -1)
+                    classEncoding[symbolClass[character]] = encodingIndex++;
+                symbolClass[character] = classEncoding[symbolClass[character]];
             }
+            classCount = encodingIndex;
+        }
 
-            // build deterministic finite automata transition table
-            // state, character -> state set
-            map<set<int>, map<char, set<int>>> deterministicTransitionTable;
+        // rows that can not reach a final row send every transition into them to the dead row instead,
+        // so a run stops at the first byte after which acceptance became impossible
+        void pruneDeadStates()
+        {
+            vector<uint32_t> predecessorOffsets(stateCount + 2, 0);
+            for (size_t cell = 0; cell < (size_t)stateCount * classCount; cell++)
+                predecessorOffsets[table[cell] + 1]++;
+            for (int state = 0; state <= stateCount; state++)
+                predecessorOffsets[state + 1] += predecessorOffsets[state];
+            vector<int> predecessors(predecessorOffsets[stateCount + 1]);
+            vector<uint32_t> position(predecessorOffsets.begin(), predecessorOffsets.end() - 1);
+            for (size_t cell = 0; cell < (size_t)stateCount * classCount; cell++)
+                predecessors[position[table[cell]]++] = cell / classCount;
+
+            vector<char> coReachable(stateCount + 1, 0);
+            vector<int> stateStack;
+            for (int state = 0; state < stateCount; state++)
+                if (finalStates[state])
+                {
+                    coReachable[state] = 1;
+                    stateStack.push_back(state);
+                }
+            while (!stateStack.empty())
+            {
+                int state = stateStack.back();
+                stateStack.pop_back();
+                for (uint32_t edge = predecessorOffsets[state]; edge < predecessorOffsets[state + 1]; edge++)
+                    if (!coReachable[predecessors[edge]])
+                    {
+                        coReachable[predecessors[edge]] = 1;
+                        stateStack.push_back(predecessors[edge]);
+                    }
+            }
 
-            // powerset state queue
-            queue<set<int>> stateQueue;
-            stateQueue.push(set<int>{initialState});
+            for (auto &cell : table)
+                if (!coReachable[cell])
+                    cell = deadState;
+            if (!coReachable[initialState])
+                initialState = deadState;
+        }
 
-            // encode set state as integer in final automata
-            map<set<int>, int> generatedStateEncoding;
-            generatedStateEncoding.insert(pair<set<int>, int>(set<int>{initialState}, 0));
-            automata.addState(0);
-            int encodingIndex = 1;
+    public:
+        DenseDFA() = default;
+        explicit DenseDFA(const DFA &dfa)
+        {
+            set<int> states = dfa.getStates();
+            map<int, map<int, set<char>>> transitions = dfa.getTransitiions();
+            vector<char> lambda = dfa.getLambdaString();
+            lambdaString = lambda;
 
-            while (!stateQueue.empty())
+            // states can be arbitrary integers, encode them as consecutive rows
+            map<int, int> stateEncoding;
+            for (auto its = states.begin(); its != states.end(); its++)
             {
-                set<int> currentState = stateQueue.front();
-                stateQueue.pop();
+                stateEncoding.insert(pair<int, int>(*its, stateCount++));
+                stateNames.emplace_back(*its);
+            }
+            deadState = stateCount;
+            stateNames.emplace_back(-1);
 
-                // generate transitions for current state set
-                map<char, set<int>> currentStateTransitions;
-                for (auto its = currentState.begin(); its != currentState.end(); its++)
-                    for (auto it = nondeterministicTransitionTable[*its].begin(); it != nondeterministicTransitionTable[*its].end(); it++)
-                        if (currentStateTransitions.find(it->first) == currentStateTransitions.end())
-                            currentStateTransitions.insert(pair<char, set<int>>(it->first, it->second));
-                        else
-                            currentStateTransitions[it->first].insert((it->second).begin(), (it->second).end());
+            auto iti = stateEncoding.find(dfa.getInitialState());
+            initialState = (iti != stateEncoding.end()) ? iti->second : deadState;
+
+            finalStates.assign(stateCount + 1, 0);
+            set<int> dfaFinalStates = dfa.getFinalStates();
+            for (auto itf = dfaFinalStates.begin(); itf != dfaFinalStates.end(); itf++)
+                if (stateEncoding.find(*itf) != stateEncoding.end())
+                    finalStates[stateEncoding[*itf]] = 1;
 
-                // new set states that haven't been encoded haven't been visited
-                for (auto it = currentStateTransitions.begin(); it != currentStateTransitions.end(); it++)
-                    if (generatedStateEncoding.find(it->second) == generatedStateEncoding.end())
+            computeSymbolClasses(transitions);
+
+            table.assign((size_t)(stateCount + 1) * classCount, deadState);
+            for (auto itt = transitions.begin(); itt != transitions.end(); itt++)
+                for (auto it = (itt->second).begin(); it != (itt->second).end(); it++)
+                    for (auto itc = (it->second).begin(); itc != (it->second).end(); itc++)
                     {
-                        stateQueue.push(it->second);
-                        generatedStateEncoding.insert(pair<set<int>, int>(it->second, encodingIndex));
-                        automata.addState(encodingIndex);
-                        encodingIndex++;
+                        int &cell = table[(size_t)stateEncoding[itt->first] * classCount + symbolClass[(unsigned char)*itc]];
+                        if (cell != deadState && cell != stateEncoding[it->first])
+                            throw(runtime_error("Automata is not deterministic."));
+                        cell = stateEncoding[it->first];
                     }
+            pruneDeadStates();
+        }
+
+        bool evaluateString(string_view str) const
+        {
+            if (str.size() == lambdaString.size() && equal(str.begin(), str.end(), lambdaString.begin()))
+                return finalStates[initialState];
+
+            // dead rows are pruned, so the dead row is the only state a word can not recover from
+            int state = initialState;
+            for (unsigned char character : str)
+            {
+                state = table[(size_t)state * classCount + symbolClass[character]];
+                if (state == deadState)
+                    return false;
+            }
+            return finalStates[state];
+        }
+        vector<int> evaluateStringWithPath(string_view str) const
+        {
+            if (str.size() == lambdaString.size() && equal(str.begin(), str.end(), lambdaString.begin()))
+                return finalStates[initialState] ? vector<int>{stateNames[initialState]} : vector<int>{};
 
-                deterministicTransitionTable.insert(pair<set<int>, map<char, set<int>>>(currentState, currentStateTransitions));
+            vector<int> path{stateNames[initialState]};
+            int state = initialState;
+            for (unsigned char character : str)
+            {
+                state = table[(size_t)state * classCount + symbolClass[character]];
+                if (state == deadState)
+                    return vector<int>{};
+                path.emplace_back(stateNames[state]);
             }
+            return finalStates[state] ? path : vector<int>{};
+        }
 
-            // add initial state
-            automata.setInitialState(generatedStateEncoding[set<int>{initialState}]);
+        template <typename WordType>
+        vector<bool> evaluateBatch(const vector<WordType> &words) const
+        {
+            // several words advance through the table in lockstep, each lane prefetches its next row so the
+            // loads of all lanes are in flight at once instead of one dependent load per character
+            const int batchWidth = 16;
+            const char *position[batchWidth], *end[batchWidth];
+            int state[batchWidth];
+            size_t wordIndex[batchWidth];
+            vector<bool> answers(words.size());
+            size_t nextWord = 0;
 
-            // add transitions after encoding
-            for (auto itt = deterministicTransitionTable.begin(); itt != deterministicTransitionTable.end(); itt++)
-                for (auto it = (itt->second).begin(); it != (itt->second).end(); it++)
-                    automata.addTransition(generatedStateEncoding[itt->first], generatedStateEncoding[it->second], it->first);
+            // lanes that finish are refilled with the next word, ragged lengths never leave a lane idle
+            auto refillLane = [&](int lane) -> bool
+            {
+                while (nextWord < words.size())
+                {
+                    const WordType &word = words[nextWord];
+                    if (word.empty() || (word.size() == lambdaString.size() && equal(word.begin(), word.end(), lambdaString.begin())))
+                    {
+                        answers[nextWord++] = finalStates[initialState];
+                        continue;
+                    }
+                    position[lane] = word.data();
+                    end[lane] = word.data() + word.size();
+                    state[lane] = initialState;
+                    wordIndex[lane] = nextWord++;
+                    return true;
+                }
+                return false;
+            };
 
-            // add final states after encoding
-            for (auto ite = generatedStateEncoding.begin(); ite != generatedStateEncoding.end(); ite++)
-                for (auto itf = finalStates.begin(); itf != finalStates.end(); itf++)
-                    if ((ite->first).find(*itf) != (ite->first).end())
-                        automata.addFinalState(ite->second);
+            int activeLanes = 0;
+            while (activeLanes < batchWidth && refillLane(activeLanes))
+                activeLanes++;
 
-            return automata;
+            while (activeLanes > 0)
+            {
+                for (int lane = 0; lane < activeLanes; lane++)
+                {
+                    state[lane] = table[(size_t)state[lane] * classCount + symbolClass[(unsigned char)*position[lane]++]];
+                    FA_PREFETCH(&table[(size_t)state[lane] * classCount]);
+                }
+                for (int lane = 0; lane < activeLanes;)
+                {
+                    if (position[lane] != end[lane] && state[lane] != deadState)
+                    {
+                        lane++;
+                        continue;
+                    }
+                    answers[wordIndex[lane]] = finalStates[state[lane]];
+                    if (refillLane(lane))
+                    {
+                        lane++;
+                        continue;
+                    }
+                    // no words left, move the last active lane into this slot
+                    activeLanes--;
+                    position[lane] = position[activeLanes];
+                    end[lane] = end[activeLanes];
+                    state[lane] = state[activeLanes];
+                    wordIndex[lane] = wordIndex[activeLanes];
+                }
+            }
+            return answers;
         }
+
+        void generateMatcher(ostream &out, const string &matcherName) const
+        {
+            // re2c style matcher, every state is a label and every transition a goto,
+            // so the compiler sees the whole automaton and nothing is loaded at startup
+            auto printCharacter = [&out](int character)
+            {
+                if (isalnum(character))
+                    out << "'" << (char)character << "'";
+                else
+                    out << character;
+            };
+
+            out << "// generated from a minimized DFA, do not edit" << endl;
+            out << "#pragma once" << endl;
+            out << "#include <string_view>" << endl
+                << endl;
+            out << "namespace " << matcherName << endl;
+            out << "{" << endl;
+            out << "    constexpr int stateCount = " << stateCount << ";" << endl
+                << endl;
+            out << "    inline bool match(const char *position, const char *end)" << endl;
+            out << "    {" << endl;
+            if (initialState == deadState)
+                out << "        return false;" << endl;
+            else
+                out << "        goto state" << initialState << ";" << endl;
+
+            // only states some goto leads to get a label, anything else would be an unused label
+            vector<char> reachable(stateCount + 1, 0);
+            vector<int> stateStack;
+            if (initialState != deadState)
+            {
+                reachable[initialState] = 1;
+                stateStack.push_back(initialState);
+            }
+            while (!stateStack.empty())
+            {
+                int state = stateStack.back();
+                stateStack.pop_back();
+                for (int currentClass = 0; currentClass < classCount; currentClass++)
+                {
+                    int next = table[(size_t)state * classCount + currentClass];
+                    if (next != deadState && !reachable[next])
+                    {
+                        reachable[next] = 1;
+                        stateStack.push_back(next);
+                    }
+                }
+            }
+
+            for (int state = 0; state < stateCount; state++)
+            {
+                if (!reachable[state])
+                    continue;
+
+                // the target covering the most bytes becomes the default branch
+                map<int, int> targetWeight;
+                for (int character = 0; character < 256; character++)
+                    targetWeight[table[(size_t)state * classCount + symbolClass[character]]]++;
+                int defaultTarget = deadState;
+                for (auto itw = targetWeight.begin(); itw != targetWeight.end(); itw++)
+                    if (itw->second > targetWeight[defaultTarget])
+                        defaultTarget = itw->first;
+
+                out << endl;
+                out << "    state" << state << ":" << endl;
+                out << "        if (position == end)" << endl;
+                out << "            return " << (finalStates[state] ? "true" : "false") << ";" << endl;
+                out << "        switch ((unsigned char)*position++)" << endl;
+                out << "        {" << endl;
+                for (auto itw = targetWeight.begin(); itw != targetWeight.end(); itw++)
+                {
+                    if (itw->first == defaultTarget)
+                        continue;
+                    out << "       ";
+                    for (int character = 0; character < 256; character++)
+                        if (table[(size_t)state * classCount + symbolClass[character]] == itw->first)
+                        {
+                            out << " case ";
+                            printCharacter(character);
+                            out << ":";
+                        }
+                    out << endl;
+                    if (itw->first == deadState)
+                        out << "            return false;" << endl;
+                    else
+                        out << "            goto state" << itw->first << ";" << endl;
+                }
+                out << "        default:" << endl;
+                if (defaultTarget == deadState)
+                    out << "            return false;" << endl;
+                else
+                    out << "            goto state" << defaultTarget << ";" << endl;
+                out << "        }" << endl;
+            }
+            out << "    }" << endl
+                << endl;
+
+            out << "    inline bool match(std::string_view str)" << endl;
+            out << "    {" << endl;
+            out << "        if (str == std::string_view(\"";
+            for (auto character : lambdaString)
+                out << ((character == '"' || character == '\\') ? "\\" : "") << character;
+            out << "\"))" << endl;
+            out << "            return " << (finalStates[initialState] ? "true" : "false") << ";" << endl;
+            out << "        return match(str.data(), str.data() + str.size());" << endl;
+            out << "    }" << endl;
+            out << "}" << endl;
+        }
+
+    private:
+        // copy of the automata where order[row] is the old state placed on that row, the dead row stays last
+        DenseDFA renumber(const vector<int> &order) const
+        {
+            if ((int)order.size() != stateCount)
+                throw(runtime_error("Order does not cover every state."));
+            vector<int> newIndex(stateCount + 1, -1);
+            for (int row = 0; row < stateCount; row++)
+            {
+                if (order[row] < 0 || order[row] >= stateCount || newIndex[order[row]] != -1)
+                    throw(runtime_error("Order is not a permutation of the states."));
+                newIndex[order[row]] = row;
+            }
+            newIndex[deadState] = deadState;
+
+            DenseDFA dfa = *this;
+            dfa.initialState = newIndex[initialState];
+            for (int row = 0; row <= stateCount; row++)
+            {
+                int state = (row == deadState) ? deadState : order[row];
+                dfa.finalStates[row] = finalStates[state];
+                dfa.stateNames[row] = stateNames[state];
+                for (int currentClass = 0; currentClass < classCount; currentClass++)
+                    dfa.table[(size_t)row * classCount + currentClass] = newIndex[table[(size_t)state * classCount + currentClass]];
+            }
+            return dfa;
+        }
+
+        // states the traversal never reaches keep their relative order after the reached ones
+        vector<int> completeOrder(vector<int> order, vector<char> &placed) const
+        {
+            for (int state = 0; state < stateCount; state++)
+                if (!placed[state])
+                {
+                    placed[state] = 1;
+                    order.push_back(state);
+                }
+            return order;
+        }
+
+    public:
+        enum class StateOrder
+        {
+            BreadthFirst,
+            DepthFirst
+        };
+
+        // static layout: breadth first keeps every level of the automata in consecutive rows,
+        // depth first puts a state right after the state it is first reached from
+        DenseDFA reorderStates(StateOrder stateOrder) const
+        {
+            vector<int> order;
+            vector<char> placed(stateCount + 1, 0);
+            placed[deadState] = 1;
+            if (initialState != deadState && stateOrder == StateOrder::BreadthFirst)
+            {
+                queue<int> pending;
+                pending.push(initialState);
+                placed[initialState] = 1;
+                while (!pending.empty())
+                {
+                    int state = pending.front();
+                    pending.pop();
+                    order.push_back(state);
+                    for (int currentClass = 0; currentClass < classCount; currentClass++)
+                    {
+                        int nextState = table[(size_t)state * classCount + currentClass];
+                        if (!placed[nextState])
+                        {
+                            placed[nextState] = 1;
+                            pending.push(nextState);
+                        }
+                    }
+                }
+            }
+            else if (initialState != deadState)
+            {
+                vector<int> pending{initialState};
+                while (!pending.empty())
+                {
+                    int state = pending.back();
+                    pending.pop_back();
+                    if (placed[state])
+                        continue;
+                    placed[state] = 1;
+                    order.push_back(state);
+                    // pushed in reverse so the successor on the lowest class is visited first
+                    for (int currentClass = classCount - 1; currentClass >= 0; currentClass--)
+                    {
+                        int nextState = table[(size_t)state * classCount + currentClass];
+                        if (!placed[nextState])
+                            pending.push_back(nextState);
+                    }
+                }
+            }
+            return renumber(completeOrder(order, placed));
+        }
+
+        // profile guided layout: runs the sample, then chains every state to its most traversed successor
+        // that has no row yet, starting over from the hottest remaining state when the chain ends
+        template <typename WordType>
+        DenseDFA reorderStates(const vector<WordType> &sample) const
+        {
+            vector<size_t> visits(stateCount + 1, 0), traversals((size_t)(stateCount + 1) * classCount, 0);
+            for (const auto &word : sample)
+            {
+                int state = initialState;
+                visits[state]++;
+                for (unsigned char character : word)
+                {
+                    size_t cell = (size_t)state * classCount + symbolClass[character];
+                    traversals[cell]++;
+                    state = table[cell];
+                    if (state == deadState)
+                        break;
+                    visits[state]++;
+                }
+            }
+
+            vector<int> hottest;
+            for (int state = 0; state < stateCount; state++)
+                if (visits[state])
+                    hottest.push_back(state);
+            stable_sort(hottest.begin(), hottest.end(), [&visits](int left, int right)
+                        { return visits[left] > visits[right]; });
+
+            vector<int> order;
+            vector<char> placed(stateCount + 1, 0);
+            placed[deadState] = 1;
+            for (auto chainStart : hottest)
+                for (int state = chainStart; state != deadState && !placed[state];)
+                {
+                    placed[state] = 1;
+                    order.push_back(state);
+                    int nextState = deadState;
+                    size_t bestCount = 0;
+                    for (int currentClass = 0; currentClass < classCount; currentClass++)
+                    {
+                        size_t cell = (size_t)state * classCount + currentClass;
+                        if (traversals[cell] > bestCount && !placed[table[cell]])
+                        {
+                            bestCount = traversals[cell];
+                            nextState = table[cell];
+                        }
+                    }
+                    state = nextState;
+                }
+            return renumber(completeOrder(order, placed));
+        }
+
+        DenseDFA makeUnanchored() const
+        {
+            // subset construction over symbol classes where every subset keeps the initial state,
+            // which is the same as adding a self-loop on every byte to the initial state
+            DenseDFA dfa;
+            dfa.symbolClass = symbolClass;
+            dfa.classCount = classCount;
+            dfa.lambdaString = lambdaString;
+
+            map<vector<int>, int> generatedStateEncoding;
+            vector<vector<int>> generatedStates;
+            queue<int> stateQueue;
+            vector<int> start;
+            if (initialState != deadState)
+                start.push_back(initialState);
+            generatedStateEncoding.insert(pair<vector<int>, int>(start, 0));
+            generatedStates.push_back(start);
+            stateQueue.push(0);
+
+            vector<int> generatedTable;
+            while (!stateQueue.empty())
+            {
+                int currentState = stateQueue.front();
+                stateQueue.pop();
+
+                generatedTable.resize(generatedStates.size() * classCount);
+                for (int currentClass = 0; currentClass < classCount; currentClass++)
+                {
+                    set<int> nextStates(start.begin(), start.end());
+                    for (auto state : generatedStates[currentState])
+                        if (table[(size_t)state * classCount + currentClass] != deadState)
+                            nextStates.insert(table[(size_t)state * classCount + currentClass]);
+
+                    vector<int> nextState(nextStates.begin(), nextStates.end());
+                    auto itg = generatedStateEncoding.find(nextState);
+                    if (itg == generatedStateEncoding.end())
+                    {
+                        itg = generatedStateEncoding.insert(pair<vector<int>, int>(nextState, generatedStates.size())).first;
+                        generatedStates.push_back(nextState);
+                        stateQueue.push(itg->second);
+                    }
+                    generatedTable.resize(generatedStates.size() * classCount);
+                    generatedTable[(size_t)currentState * classCount + currentClass] = itg->second;
+                }
+            }
+
+            // the unanchored automaton is complete, the dead row only keeps the layout identical
+            dfa.stateCount = generatedStates.size();
+            dfa.deadState = dfa.stateCount;
+            dfa.initialState = 0;
+            generatedTable.resize((size_t)(dfa.stateCount + 1) * classCount, dfa.deadState);
+            dfa.table = generatedTable;
+            dfa.finalStates.assign(dfa.stateCount + 1, 0);
+            for (int state = 0; state < dfa.stateCount; state++)
+            {
+                dfa.stateNames.push_back(state);
+                for (auto subsetState : generatedStates[state])
+                    if (finalStates[subsetState])
+                        dfa.finalStates[state] = 1;
+            }
+            dfa.stateNames.push_back(-1);
+            return dfa;
+        }
+
+        // automata read right to left that is in a final state exactly where a word of the language starts,
+        // its states are the sets of states that still reach a final state over the text read so far, every
+        // set keeps the final states since a word may also end right here. the subset construction gives up
+        // and returns false once it goes past maximumStates
+        bool makeReversedUnanchored(DenseDFA &dfa, size_t maximumStates = 1 << 16) const
+        {
+            dfa = DenseDFA();
+            dfa.symbolClass = symbolClass;
+            dfa.classCount = classCount;
+
+            // class -> state -> predecessors, the dead row never reaches a final state so it is left out
+            vector<vector<vector<int>>> predecessors(classCount, vector<vector<int>>(stateCount));
+            for (int state = 0; state < stateCount; state++)
+                for (int currentClass = 0; currentClass < classCount; currentClass++)
+                    if (table[(size_t)state * classCount + currentClass] != deadState)
+                        predecessors[currentClass][table[(size_t)state * classCount + currentClass]].push_back(state);
+
+            vector<int> start;
+            for (int state = 0; state < stateCount; state++)
+                if (finalStates[state])
+                    start.push_back(state);
+            map<vector<int>, int> generatedStateEncoding{{start, 0}};
+            vector<vector<int>> generatedStates{start};
+            vector<int> generatedTable;
+            for (size_t currentState = 0; currentState < generatedStates.size(); currentState++)
+            {
+                generatedTable.resize(generatedStates.size() * classCount);
+                for (int currentClass = 0; currentClass < classCount; currentClass++)
+                {
+                    set<int> nextStates(start.begin(), start.end());
+                    for (auto state : generatedStates[currentState])
+                        nextStates.insert(predecessors[currentClass][state].begin(), predecessors[currentClass][state].end());
+
+                    vector<int> nextState(nextStates.begin(), nextStates.end());
+                    auto itg = generatedStateEncoding.find(nextState);
+                    if (itg == generatedStateEncoding.end())
+                    {
+                        if (generatedStates.size() >= maximumStates)
+                            return false;
+                        itg = generatedStateEncoding.insert(pair<vector<int>, int>(nextState, generatedStates.size())).first;
+                        generatedStates.push_back(nextState);
+                    }
+                    generatedTable[currentState * classCount + currentClass] = itg->second;
+                }
+            }
+
+            dfa.stateCount = generatedStates.size();
+            dfa.deadState = dfa.stateCount;
+            dfa.initialState = 0;
+            generatedTable.resize((size_t)(dfa.stateCount + 1) * classCount, dfa.deadState);
+            dfa.table = generatedTable;
+            dfa.finalStates.assign(dfa.stateCount + 1, 0);
+            for (int state = 0; state < dfa.stateCount; state++)
+            {
+                dfa.stateNames.push_back(state);
+                dfa.finalStates[state] = binary_search(generatedStates[state].begin(), generatedStates[state].end(), initialState);
+            }
+            dfa.stateNames.push_back(-1);
+            return true;
+        }
+
+        // Moore refinement over the dense table, every round splits blocks by (block, successor blocks).
+        // the per state hashes, the sharded block numbering and the relabelling of a round are spread over
+        // threadCount threads, shards are fixed so the partition never depends on the thread count, and the
+        // result is renumbered breadth first from the initial state so it is identical for every thread count
+        DenseDFA minimize(unsigned threadCount = 1) const
+        {
+            const int rowCount = stateCount + 1;
+            const int shardCount = 64;
+            threadCount = max(1u, min(threadCount, (unsigned)rowCount));
+
+            auto parallelFor = [threadCount](size_t count, const function<void(size_t, size_t, unsigned)> &body)
+            {
+                if (threadCount == 1)
+                {
+                    body(0, count, 0);
+                    return;
+                }
+                vector<thread> threads;
+                for (unsigned index = 0; index < threadCount; index++)
+                    threads.emplace_back(body, count * index / threadCount, count * (index + 1) / threadCount, index);
+                for (auto &worker : threads)
+                    worker.join();
+            };
+
+            vector<int> block(rowCount), nextBlock(rowCount), localBlock(rowCount);
+            vector<uint64_t> signatureHash(rowCount);
+            int blockCount = 0;
+            for (int state = 0; state < rowCount; state++)
+                block[state] = finalStates[state];
+            blockCount = *max_element(block.begin(), block.end()) + 1;
+
+            auto sameSignature = [&](int left, int right)
+            {
+                if (block[left] != block[right])
+                    return false;
+                for (int currentClass = 0; currentClass < classCount; currentClass++)
+                    if (block[table[(size_t)left * classCount + currentClass]] != block[table[(size_t)right * classCount + currentClass]])
+                        return false;
+                return true;
+            };
+
+            vector<vector<size_t>> shardCounts(threadCount, vector<size_t>(shardCount));
+            vector<int> shardStates(rowCount);
+            vector<size_t> shardStart(shardCount + 1);
+            vector<int> shardBlocks(shardCount), shardBase(shardCount);
+            while (true)
+            {
+                parallelFor(rowCount, [&](size_t first, size_t last, unsigned worker)
+                            {
+                    fill(shardCounts[worker].begin(), shardCounts[worker].end(), 0);
+                    for (size_t state = first; state < last; state++)
+                    {
+                        uint64_t hash = block[state] * 0x9E3779B97F4A7C15ull;
+                        for (int currentClass = 0; currentClass < classCount; currentClass++)
+                            hash = (hash ^ (uint64_t)block[table[state * classCount + currentClass]]) * 0x100000001B3ull + (hash >> 29);
+                        signatureHash[state] = hash;
+                        shardCounts[worker][hash % shardCount]++;
+                    } });
+
+                // counting sort of the states by shard, every shard keeps its states in increasing order
+                vector<vector<size_t>> shardPosition(threadCount, vector<size_t>(shardCount));
+                size_t position = 0;
+                for (int shard = 0; shard < shardCount; shard++)
+                {
+                    shardStart[shard] = position;
+                    for (unsigned worker = 0; worker < threadCount; worker++)
+                    {
+                        shardPosition[worker][shard] = position;
+                        position += shardCounts[worker][shard];
+                    }
+                }
+                shardStart[shardCount] = position;
+                parallelFor(rowCount, [&](size_t first, size_t last, unsigned worker)
+                            {
+                    for (size_t state = first; state < last; state++)
+                        shardStates[shardPosition[worker][signatureHash[state] % shardCount]++] = state; });
+
+                // blocks get local numbers inside their shard, in order of their smallest state
+                parallelFor(shardCount, [&](size_t first, size_t last, unsigned)
+                            {
+                    for (size_t shard = first; shard < last; shard++)
+                    {
+                        unordered_map<uint64_t, vector<pair<int, int>>> representatives;
+                        int localCount = 0;
+                        for (size_t index = shardStart[shard]; index < shardStart[shard + 1]; index++)
+                        {
+                            int state = shardStates[index];
+                            auto &candidates = representatives[signatureHash[state]];
+                            int found = -1;
+                            for (const auto &candidate : candidates)
+                                if (sameSignature(candidate.first, state))
+                                {
+                                    found = candidate.second;
+                                    break;
+                                }
+                            if (found == -1)
+                            {
+                                found = localCount++;
+                                candidates.emplace_back(state, found);
+                            }
+                            localBlock[state] = found;
+                        }
+                        shardBlocks[shard] = localCount;
+                    } });
+
+                int nextBlockCount = 0;
+                for (int shard = 0; shard < shardCount; shard++)
+                {
+                    shardBase[shard] = nextBlockCount;
+                    nextBlockCount += shardBlocks[shard];
+                }
+                parallelFor(rowCount, [&](size_t first, size_t last, unsigned)
+                            {
+                    for (size_t state = first; state < last; state++)
+                        nextBlock[state] = shardBase[signatureHash[state] % shardCount] + localBlock[state]; });
+
+                block.swap(nextBlock);
+                // a round only ever splits blocks, the same count means nothing changed
+                if (nextBlockCount == blockCount)
+                    break;
+                blockCount = nextBlockCount;
+            }
+
+            // one row per block reachable from the initial state, breadth first, the dead block becomes the dead row
+            int deadBlock = block[deadState];
+            vector<int> representative(blockCount, -1), blockEncoding(blockCount, -1);
+            for (int state = rowCount - 1; state >= 0; state--)
+                representative[block[state]] = state;
+
+            DenseDFA dfa;
+            dfa.symbolClass = symbolClass;
+            dfa.classCount = classCount;
+            dfa.lambdaString = lambdaString;
+            vector<int> order;
+            if (block[initialState] != deadBlock)
+            {
+                blockEncoding[block[initialState]] = 0;
+                order.push_back(block[initialState]);
+            }
+            for (size_t index = 0; index < order.size(); index++)
+                for (int currentClass = 0; currentClass < classCount; currentClass++)
+                {
+                    int nextBlock = block[table[(size_t)representative[order[index]] * classCount + currentClass]];
+                    if (nextBlock != deadBlock && blockEncoding[nextBlock] == -1)
+                    {
+                        blockEncoding[nextBlock] = order.size();
+                        order.push_back(nextBlock);
+                    }
+                }
+
+            dfa.stateCount = order.size();
+            dfa.deadState = dfa.stateCount;
+            dfa.initialState = order.empty() ? dfa.deadState : 0;
+            blockEncoding[deadBlock] = dfa.deadState;
+            dfa.table.assign((size_t)(dfa.stateCount + 1) * classCount, dfa.deadState);
+            dfa.finalStates.assign(dfa.stateCount + 1, 0);
+            for (int state = 0; state < dfa.stateCount; state++)
+            {
+                int source = representative[order[state]];
+                dfa.finalStates[state] = finalStates[source];
+                dfa.stateNames.push_back(state);
+                for (int currentClass = 0; currentClass < classCount; currentClass++)
+                    dfa.table[(size_t)state * classCount + currentClass] = blockEncoding[block[table[(size_t)source * classCount + currentClass]]];
+            }
+            dfa.stateNames.push_back(-1);
+            return dfa;
+        }
+
+        int getStateCount() const { return stateCount; }
+        int getClassCount() const { return classCount; }
+        int getInitialState() const { return initialState; }
+        int getDeadState() const { return deadState; }
+        int getSymbolClass(unsigned char character) const { return symbolClass[character]; }
+        int getNextState(int state, unsigned char character) const { return table[(size_t)state * classCount + symbolClass[character]]; }
+        bool isFinalState(int state) const { return finalStates[state]; }
+        int getStateName(int state) const { return stateNames[state]; }
+        size_t getTableSize() const { return table.size() * sizeof(int); }
+
+        friend ostream &operator<<(ostream &out, const DenseDFA &dfa)
+        {
+            out << "States: " << dfa.stateCount << " (+1 dead)" << endl;
+            out << "Symbol classes: " << dfa.classCount << endl;
+            for (int symbolClass = 0; symbolClass < dfa.classCount; symbolClass++)
+            {
+                out << "Class " << symbolClass << ": ";
+                int printed = 0;
+                for (int character = 0; character < 256; character++)
+                    if (dfa.symbolClass[character] == symbolClass && printed++ < 16)
+                        out << (isprint(character) ? string(1, (char)character) : "\\" + to_string(character)) << " ";
+                if (printed > 16)
+                    out << "... (" << printed << " bytes)";
+                out << endl;
+            }
+            out << "Table size: " << dfa.getTableSize() << " bytes instead of "
+                << (size_t)(dfa.stateCount + 1) * 256 * sizeof(int) << endl;
+            return out;
+        }
+    };
+
+    struct Match
+    {
+        size_t start, end;
+    };
+
+    enum class MatchSemantics
+    {
+        LeftmostLongest,
+        AllOverlapping
+    };
+
+    class Scanner
+    {
+    private:
+        DenseDFA anchored;
+        DenseDFA unanchored;
+        // run backwards over the text it marks every position some match starts at, so the anchored runs
+        // of findAll never start where nothing can match. left out when its construction blows up
+        DenseDFA reversed;
+        bool hasReversed = false;
+        // bytes every match has to start with, used to skip regions that cannot match
+        string literalPrefix;
+        int prefixState;
+        array<bool, 256> firstBytes{};
+        int firstByteCount = 0;
+
+        // next position at or after the given one where a match could start
+        size_t nextCandidate(string_view text, size_t position) const
+        {
+            if (!literalPrefix.empty())
+            {
+                size_t found = (literalPrefix.size() == 1) ? text.find(literalPrefix[0], position)
+                                                           : text.find(literalPrefix, position);
+                return (found == string_view::npos) ? text.size() : found;
+            }
+            while (position < text.size() && !firstBytes[(unsigned char)text[position]])
+                position++;
+            return position;
+        }
+
+        // stops at the first match when no output vector is given
+        bool runUnanchored(string_view text, vector<size_t> *matchEnds) const
+        {
+            if (firstByteCount == 0)
+                return false;
+
+            bool found = false;
+            int startState = unanchored.getInitialState();
+            int state = startState;
+            size_t position = 0;
+            while (position < text.size())
+            {
+                // nothing is in progress, jump straight to the next place a match can start
+                if (state == startState)
+                {
+                    position = nextCandidate(text, position);
+                    if (position == text.size())
+                        break;
+                }
+                state = unanchored.getNextState(state, text[position++]);
+                if (unanchored.isFinalState(state))
+                {
+                    found = true;
+                    if (matchEnds == nullptr)
+                        break;
+                    matchEnds->push_back(position);
+                }
+            }
+            return found;
+        }
+
+    public:
+        explicit Scanner(const DFA &dfa) : anchored(dfa), unanchored(anchored.makeUnanchored())
+        {
+            hasReversed = anchored.makeReversedUnanchored(reversed);
+            int initialState = anchored.getInitialState();
+            for (int character = 0; character < 256; character++)
+                if (anchored.getNextState(initialState, character) != anchored.getDeadState())
+                {
+                    firstBytes[character] = true;
+                    firstByteCount++;
+                }
+
+            // follow the chain of states with a single way out to get the literal prefix
+            prefixState = initialState;
+            while (literalPrefix.size() < 64 && !anchored.isFinalState(prefixState))
+            {
+                int onlyCharacter = -1, outgoingCount = 0;
+                for (int character = 0; character < 256 && outgoingCount < 2; character++)
+                    if (anchored.getNextState(prefixState, character) != anchored.getDeadState())
+                    {
+                        onlyCharacter = character;
+                        outgoingCount++;
+                    }
+                if (outgoingCount != 1)
+                    break;
+                literalPrefix.push_back((char)onlyCharacter);
+                prefixState = anchored.getNextState(prefixState, onlyCharacter);
+            }
+        }
+
+        // every match as [start, end), empty matches are not reported. one backward pass marks the positions
+        // where a match starts and only those get an anchored run, so text that never matches costs linear
+        // time however long the failed attempts would have run. a run still reads as far as a match could
+        // extend, which stays quadratic when matches start everywhere and can extend far without ending,
+        // e.g. a|a*b on aaa...a. maximumRunLength caps every run for callers that need a bound and only
+        // care about matches up to that length
+        vector<Match> findAll(string_view text, MatchSemantics semantics = MatchSemantics::LeftmostLongest,
+                              size_t maximumRunLength = SIZE_MAX) const
+        {
+            vector<Match> matches;
+            if (firstByteCount == 0)
+                return matches;
+
+            vector<char> starts;
+            if (hasReversed)
+            {
+                starts.assign(text.size() + 1, 0);
+                int state = reversed.getInitialState();
+                starts[text.size()] = reversed.isFinalState(state);
+                for (size_t index = text.size(); index > 0; index--)
+                {
+                    state = reversed.getNextState(state, text[index - 1]);
+                    starts[index - 1] = reversed.isFinalState(state);
+                }
+            }
+            auto nextStart = [&](size_t position)
+            {
+                position = nextCandidate(text, position);
+                while (!starts.empty() && position < text.size() && !starts[position])
+                    position = nextCandidate(text, position + 1);
+                return position;
+            };
+
+            size_t position = nextStart(0);
+            while (position < text.size())
+            {
+                size_t index = position, longestEnd = position;
+                int state = anchored.getInitialState();
+                if (!literalPrefix.empty())
+                {
+                    // the candidate already starts with the prefix
+                    index += literalPrefix.size();
+                    state = prefixState;
+                    if (anchored.isFinalState(state))
+                    {
+                        if (semantics == MatchSemantics::AllOverlapping)
+                            matches.push_back(Match{position, index});
+                        longestEnd = index;
+                    }
+                }
+                size_t runEnd = (text.size() - position > maximumRunLength) ? position + maximumRunLength : text.size();
+                while (index < runEnd && state != anchored.getDeadState())
+                {
+                    state = anchored.getNextState(state, text[index++]);
+                    if (anchored.isFinalState(state))
+                    {
+                        if (semantics == MatchSemantics::AllOverlapping)
+                            matches.push_back(Match{position, index});
+                        longestEnd = index;
+                    }
+                }
+
+                if (semantics == MatchSemantics::LeftmostLongest && longestEnd > position)
+                {
+                    matches.push_back(Match{position, longestEnd});
+                    position = nextStart(longestEnd);
+                }
+                else
+                    position = nextStart(position + 1);
+            }
+            return matches;
+        }
+
+        // single pass over the text with the unanchored automaton, reports the end of every match
+        vector<size_t> findMatchEnds(string_view text) const
+        {
+            vector<size_t> matchEnds;
+            runUnanchored(text, &matchEnds);
+            return matchEnds;
+        }
+
+        bool contains(string_view text) const
+        {
+            return runUnanchored(text, nullptr);
+        }
+
+        const string &getLiteralPrefix() const { return literalPrefix; }
+        const DenseDFA &getUnanchored() const { return unanchored; }
+    };
+
+    struct ReductionReport
+    {
+        size_t originalStates = 0, originalTransitions = 0;
+        size_t bisimulationStates = 0;
+        size_t reducedStates = 0, reducedTransitions = 0;
+
+        double getStateRatio() const { return originalStates ? (double)reducedStates / originalStates : 1; }
+        double getTransitionRatio() const { return originalTransitions ? (double)reducedTransitions / originalTransitions : 1; }
+
+        friend ostream &operator<<(ostream &out, const ReductionReport &report)
+        {
+            out << "States: " << report.originalStates << " -> " << report.bisimulationStates << " (bisimulation) -> "
+                << report.reducedStates << " (" << report.getStateRatio() * 100 << "%)" << endl;
+            out << "Transitions: " << report.originalTransitions << " -> " << report.reducedTransitions
+                << " (" << report.getTransitionRatio() * 100 << "%)" << endl;
+            return out;
+        }
+    };
+
+    // limits for the subset construction, the memory is an estimate of what the generated subsets,
+    // their index and the resulting DFA hold on the heap
+    struct DeterminizationBudget
+    {
+        size_t maximumStates = SIZE_MAX;
+        size_t maximumMemory = SIZE_MAX;
+    };
+
+    // when the budget runs out complete is false and the automata holds the states generated so far,
+    // states that were never expanded have no outgoing transitions
+    struct DeterminizationResult
+    {
+        DFA automata;
+        bool complete = true;
+        size_t generatedStates = 0;
+        size_t estimatedMemory = 0;
+    };
+
+    class NFA : public FA<int, char>
+    {
+    protected:
+        // the automaton with lambda transitions folded into the ordinary ones, states numbered densely
+        struct LambdaFreeView
+        {
+            int initialState = 0;
+            vector<char> finalStates;
+            // state -> character -> sorted targets
+            vector<map<char, vector<int>>> post;
+        };
+
+        LambdaFreeView lambdaFree() const
+        {
+            map<int, int> stateEncoding;
+            vector<int> stateNames;
+            for (auto its = states.begin(); its != states.end(); its++)
+            {
+                stateEncoding.insert(pair<int, int>(*its, stateNames.size()));
+                stateNames.push_back(*its);
+            }
+            int stateCount = stateNames.size();
+
+            vector<vector<int>> lambdaEdges(stateCount);
+            vector<map<char, set<int>>> edges(stateCount);
+            for (auto itt = transitions.begin(); itt != transitions.end(); itt++)
+                for (auto it = (itt->second).begin(); it != (itt->second).end(); it++)
+                    for (auto itc = (it->second).begin(); itc != (it->second).end(); itc++)
+                        if (*itc == lambdaCharacter)
+                            lambdaEdges[stateEncoding[itt->first]].push_back(stateEncoding[it->first]);
+                        else
+                            edges[stateEncoding[itt->first]][*itc].insert(stateEncoding[it->first]);
+
+            auto closure = [&](set<int> stateSet)
+            {
+                vector<int> stateStack(stateSet.begin(), stateSet.end());
+                while (!stateStack.empty())
+                {
+                    int state = stateStack.back();
+                    stateStack.pop_back();
+                    for (auto next : lambdaEdges[state])
+                        if (stateSet.insert(next).second)
+                            stateStack.push_back(next);
+                }
+                return stateSet;
+            };
+
+            LambdaFreeView view;
+            view.initialState = stateEncoding.count(initialState) ? stateEncoding[initialState] : 0;
+            view.finalStates.assign(stateCount, 0);
+            view.post.resize(stateCount);
+            for (int state = 0; state < stateCount; state++)
+            {
+                set<int> start = closure(set<int>{state});
+                map<char, set<int>> reached;
+                for (auto from : start)
+                {
+                    if (finalStates.find(stateNames[from]) != finalStates.end())
+                        view.finalStates[state] = 1;
+                    for (const auto &edge : edges[from])
+                        reached[edge.first].insert(edge.second.begin(), edge.second.end());
+                }
+                for (const auto &edge : reached)
+                {
+                    set<int> targets = closure(edge.second);
+                    view.post[state][edge.first] = vector<int>(targets.begin(), targets.end());
+                }
+            }
+            return view;
+        }
+
+        // maximal forward simulation, simulation(p, q) means q can mimic every move of p, which implies that the
+        // language of p is contained in the language of q. without useSimulation it is only the identity and no
+        // matrix is allocated
+        struct Simulation
+        {
+            vector<vector<char>> relation;
+
+            bool operator()(int first, int second) const { return relation.empty() ? first == second : relation[first][second]; }
+        };
+
+        // counter based refinement: for every state q with a move on a and every state p' the counter holds how many
+        // a successors of q still simulate p'. a pair is removed once, and when a counter drops to zero every
+        // a predecessor of p' stops being simulated by q, so the work is bounded by transitions times states
+        static Simulation forwardSimulation(const LambdaFreeView &view, bool useSimulation)
+        {
+            Simulation simulation;
+            if (!useSimulation)
+                return simulation;
+
+            int stateCount = view.post.size();
+            vector<map<char, vector<int>>> pre(stateCount);
+            vector<map<char, int>> slots(stateCount);
+            int slotCount = 0;
+            for (int state = 0; state < stateCount; state++)
+                for (const auto &edge : view.post[state])
+                {
+                    slots[state][edge.first] = slotCount++;
+                    for (auto target : edge.second)
+                        pre[target][edge.first].push_back(state);
+                }
+
+            // q can only simulate p when it is final whenever p is and has a move on every character p has
+            vector<vector<char>> &relation = simulation.relation;
+            relation.assign(stateCount, vector<char>(stateCount, 0));
+            for (int first = 0; first < stateCount; first++)
+                for (int second = 0; second < stateCount; second++)
+                {
+                    bool possible = !view.finalStates[first] || view.finalStates[second];
+                    for (auto itp = view.post[first].begin(); possible && itp != view.post[first].end(); itp++)
+                        possible = view.post[second].count(itp->first) != 0;
+                    relation[first][second] = possible;
+                }
+
+            vector<int> counters((size_t)slotCount * stateCount, 0);
+            for (int state = 0; state < stateCount; state++)
+                for (const auto &edge : view.post[state])
+                {
+                    size_t offset = (size_t)slots[state][edge.first] * stateCount;
+                    for (auto target : edge.second)
+                        for (int simulated = 0; simulated < stateCount; simulated++)
+                            counters[offset + simulated] += relation[simulated][target];
+                }
+
+            vector<pair<int, int>> removed;
+            auto exhausted = [&](int state, char character, int simulated)
+            {
+                auto itp = pre[simulated].find(character);
+                if (itp == pre[simulated].end())
+                    return;
+                for (auto predecessor : itp->second)
+                    if (relation[predecessor][state])
+                    {
+                        relation[predecessor][state] = 0;
+                        removed.emplace_back(predecessor, state);
+                    }
+            };
+            for (int state = 0; state < stateCount; state++)
+                for (const auto &edge : view.post[state])
+                {
+                    size_t offset = (size_t)slots[state][edge.first] * stateCount;
+                    for (int simulated = 0; simulated < stateCount; simulated++)
+                        if (counters[offset + simulated] == 0)
+                            exhausted(state, edge.first, simulated);
+                }
+
+            while (!removed.empty())
+            {
+                pair<int, int> pairRemoved = removed.back();
+                removed.pop_back();
+                for (const auto &edge : pre[pairRemoved.second])
+                    for (auto predecessor : edge.second)
+                        if (--counters[(size_t)slots[predecessor][edge.first] * stateCount + pairRemoved.first] == 0)
+                            exhausted(predecessor, edge.first, pairRemoved.first);
+            }
+            return simulation;
+        }
+
+        // antichain search for a word accepted from the left automaton but not from the right one,
+        // pairs (p, S) are explored forward and a pair is dropped when an explored pair is at least as close to a counterexample
+        static bool findCounterexample(const LambdaFreeView &left, const LambdaFreeView &right, bool useSimulation, string &counterexample)
+        {
+            Simulation leftSimulation = forwardSimulation(left, useSimulation);
+            Simulation rightSimulation = forwardSimulation(right, useSimulation);
+
+            // states simulated by another state of the set add nothing to its language
+            auto reduce = [&rightSimulation](const vector<int> &stateSet)
+            {
+                vector<int> reduced;
+                for (size_t index = 0; index < stateSet.size(); index++)
+                {
+                    bool redundant = false;
+                    for (size_t other = 0; other < stateSet.size() && !redundant; other++)
+                        if (other != index && rightSimulation(stateSet[index], stateSet[other]) &&
+                            (!rightSimulation(stateSet[other], stateSet[index]) || other < index))
+                            redundant = true;
+                    if (!redundant)
+                        reduced.push_back(stateSet[index]);
+                }
+                return reduced;
+            };
+            // (p, S) is subsumed by (r, T) when L(p) is in L(r) and L(T) is in L(S)
+            auto subsumes = [&](int leftState, const vector<int> &stateSet, int otherLeftState, const vector<int> &otherSet)
+            {
+                if (!leftSimulation(leftState, otherLeftState))
+                    return false;
+                for (auto state : otherSet)
+                {
+                    bool simulated = false;
+                    for (auto candidate : stateSet)
+                        if (rightSimulation(state, candidate))
+                        {
+                            simulated = true;
+                            break;
+                        }
+                    if (!simulated)
+                        return false;
+                }
+                return true;
+            };
+            auto isBad = [&](int leftState, const vector<int> &stateSet)
+            {
+                if (!left.finalStates[leftState])
+                    return false;
+                for (auto state : stateSet)
+                    if (right.finalStates[state])
+                        return false;
+                return true;
+            };
+
+            struct SearchNode
+            {
+                int leftState;
+                vector<int> stateSet;
+                int parent;
+                char character;
+                bool active;
+            };
+            vector<SearchNode> searchNodes;
+            vector<int> antichain;
+            queue<int> workQueue;
+
+            auto buildWord = [&](int node)
+            {
+                string word;
+                for (; searchNodes[node].parent != -1; node = searchNodes[node].parent)
+                    word.push_back(searchNodes[node].character);
+                reverse(word.begin(), word.end());
+                return word;
+            };
+
+            searchNodes.push_back(SearchNode{left.initialState, reduce(vector<int>{right.initialState}), -1, 0, true});
+            if (isBad(left.initialState, searchNodes[0].stateSet))
+            {
+                counterexample = "";
+                return true;
+            }
+            antichain.push_back(0);
+            workQueue.push(0);
+
+            while (!workQueue.empty())
+            {
+                int node = workQueue.front();
+                workQueue.pop();
+                if (!searchNodes[node].active)
+                    continue;
+
+                for (const auto &edge : left.post[searchNodes[node].leftState])
+                {
+                    // successors of the right set on this character
+                    set<int> reached;
+                    for (auto state : searchNodes[node].stateSet)
+                    {
+                        auto itp = right.post[state].find(edge.first);
+                        if (itp != right.post[state].end())
+                            reached.insert(itp->second.begin(), itp->second.end());
+                    }
+                    vector<int> nextSet = reduce(vector<int>(reached.begin(), reached.end()));
+
+                    for (auto nextLeftState : edge.second)
+                    {
+                        if (isBad(nextLeftState, nextSet))
+                        {
+                            searchNodes.push_back(SearchNode{nextLeftState, nextSet, node, edge.first, true});
+                            counterexample = buildWord(searchNodes.size() - 1);
+                            return true;
+                        }
+
+                        bool subsumed = false;
+                        for (auto explored : antichain)
+                            if (subsumes(nextLeftState, nextSet, searchNodes[explored].leftState, searchNodes[explored].stateSet))
+                            {
+                                subsumed = true;
+                                break;
+                            }
+                        if (subsumed)
+                            continue;
+
+                        // the new pair makes the ones it subsumes redundant
+                        vector<int> keptAntichain;
+                        for (auto explored : antichain)
+                            if (subsumes(searchNodes[explored].leftState, searchNodes[explored].stateSet, nextLeftState, nextSet))
+                                searchNodes[explored].active = false;
+                            else
+                                keptAntichain.push_back(explored);
+                        antichain.swap(keptAntichain);
+
+                        searchNodes.push_back(SearchNode{nextLeftState, nextSet, node, edge.first, true});
+                        antichain.push_back(searchNodes.size() - 1);
+                        workQueue.push(searchNodes.size() - 1);
+                    }
+                }
+            }
+            return false;
+        }
+
+        void DFS(bool &ok, int depth, const vector<char> &word, int currentState, vector<vector<pair<int, char>>> &solutionPaths,
+                 vector<pair<int, char>> &currentPath, set<int> &lambdaStates) const
+        {
+            if (depth == word.size() && finalStates.find(currentState) != finalStates.end())
+            {
+                ok = true;
+                solutionPaths.emplace_back(currentPath);
+            }
+            else
+            {
+                auto itt = transitions.find(currentState);
+                if (itt != transitions.end())
+                    for (auto it = (itt->second).begin(); it != (itt->second).end(); it++)
+                    {
+                        if ((it->second).find(lambdaCharacter) != (it->second).end() && lambdaStates.find(it->first) == lambdaStates.end())
+                        {
+                            lambdaStates.insert(it->first);
+                            currentPath.emplace_back(pair<int, char>(it->first, lambdaCharacter));
+                            DFS(ok, depth, word, it->first, solutionPaths, currentPath, lambdaStates);
+                            currentPath.pop_back();
+                        }
+                        // lambda moves only loop within one position, after a symbol every state may be visited again
+                        if (depth < (int)word.size() && (it->second).find(word[depth]) != (it->second).end())
+                        {
+                            set<int> nextLambdaStates;
+                            currentPath.emplace_back(pair<int, char>(it->first, word[depth]));
+                            DFS(ok, depth + 1, word, it->first, solutionPaths, currentPath, nextLambdaStates);
+                            currentPath.pop_back();
+                        }
+                    }
+            }
+        }
+
+    public:
+        NFA(int initialState = 0, char lambdaCharacter = '0', string lambdaString = "-")
+            : FA<int, char>(initialState, lambdaCharacter, vector<char>(lambdaString.begin(), lambdaString.end())) {}
+
+        // the lambda string stands for the empty word, which may still need lambda moves to be accepted
+        bool evaluateString(const string &str) const
+        {
+            vector<char> strVector(str.begin(), str.end());
+            if (strVector == lambdaString)
+                strVector.clear();
+
+            bool ok = false;
+            vector<pair<int, char>> current;
+            vector<vector<pair<int, char>>> solutions;
+            set<int> lambda;
+            DFS(ok, 0, strVector, initialState, solutions, current, lambda);
+            return ok;
+        }
+
+        vector<vector<int>> evaluateStringWithPath(const string &str) const
+        {
+            vector<char> strVector(str.begin(), str.end());
+            vector<vector<int>> answer;
+            if (strVector == lambdaString)
+                strVector.clear();
+
+            bool ok = false;
+            vector<pair<int, char>> current;
+            vector<vector<pair<int, char>>> solutions;
+            set<int> lambda;
+            DFS(ok, 0, strVector, initialState, solutions, current, lambda);
+            if (!ok)
+                return answer;
+
+            for (const auto &solution : solutions)
+            {
+                vector<int> path{initialState};
+                for (auto transition : solution)
+                    path.emplace_back(transition.first);
+                answer.emplace_back(path);
+            }
+
+            return answer;
+        }
+
+        // checks L(this) is contained in L(other) without determinizing either automaton,
+        // on failure the counterexample is accepted by this and rejected by other
+        bool isIncludedIn(const NFA &other, string &counterexample, bool useSimulation = true) const
+        {
+            bool found = findCounterexample(lambdaFree(), other.lambdaFree(), useSimulation, counterexample);
+            if (found && counterexample.empty())
+                counterexample = string(lambdaString.begin(), lambdaString.end());
+            return !found;
+        }
+
+        // checks that every word over the alphabet is accepted, the automaton's own symbols by default
+        bool isUniversal(const set<char> &alphabet, string &counterexample, bool useSimulation = true) const
+        {
+            LambdaFreeView everything;
+            everything.finalStates.assign(1, 1);
+            everything.post.resize(1);
+            for (auto character : alphabet)
+                everything.post[0][character] = vector<int>{0};
+
+            bool found = findCounterexample(everything, lambdaFree(), useSimulation, counterexample);
+            if (found && counterexample.empty())
+                counterexample = string(lambdaString.begin(), lambdaString.end());
+            return !found;
+        }
+        bool isUniversal(string &counterexample, bool useSimulation = true) const
+        {
+            set<char> alphabet;
+            for (auto itt = transitions.begin(); itt != transitions.end(); itt++)
+                for (auto it = (itt->second).begin(); it != (itt->second).end(); it++)
+                    for (auto itc = (it->second).begin(); itc != (it->second).end(); itc++)
+                        if (*itc != lambdaCharacter)
+                            alphabet.insert(*itc);
+            return isUniversal(alphabet, counterexample, useSimulation);
+        }
+
+        // merges bisimilar states, then drops every edge p -a-> q for which p -a-> q' exists with q simulated by q',
+        // then every edge p -a-> q for which p' -a-> q exists with p backward simulated by p'. the backward pass runs
+        // on the result of the forward one, the two relations are never used together since that is not sound.
+        // lambda transitions are folded away first so the result is lambda free, the language stays the same
+        NFA reduce(ReductionReport *report = nullptr) const
+        {
+            LambdaFreeView view = lambdaFree();
+            int stateCount = view.post.size();
+
+            // bisimulation by partition refinement, starting from final / non final
+            vector<int> block(stateCount);
+            for (int state = 0; state < stateCount; state++)
+                block[state] = view.finalStates[state];
+            int blockCount = -1;
+            while (true)
+            {
+                map<pair<int, vector<pair<char, int>>>, int> blockEncoding;
+                vector<int> nextBlock(stateCount);
+                for (int state = 0; state < stateCount; state++)
+                {
+                    vector<pair<char, int>> signature;
+                    for (const auto &edge : view.post[state])
+                        for (auto target : edge.second)
+                            signature.emplace_back(edge.first, block[target]);
+                    sort(signature.begin(), signature.end());
+                    signature.erase(unique(signature.begin(), signature.end()), signature.end());
+                    nextBlock[state] = blockEncoding.insert(make_pair(make_pair(block[state], signature), (int)blockEncoding.size())).first->second;
+                }
+                block.swap(nextBlock);
+                if ((int)blockEncoding.size() == blockCount)
+                    break;
+                blockCount = blockEncoding.size();
+            }
+
+            LambdaFreeView quotient;
+            quotient.initialState = stateCount ? block[view.initialState] : 0;
+            quotient.finalStates.assign(blockCount, 0);
+            quotient.post.resize(blockCount);
+            for (int state = 0; state < stateCount; state++)
+            {
+                quotient.finalStates[block[state]] = view.finalStates[state];
+                for (const auto &edge : view.post[state])
+                    for (auto target : edge.second)
+                        quotient.post[block[state]][edge.first].push_back(block[target]);
+            }
+            for (auto &edges : quotient.post)
+                for (auto &edge : edges)
+                {
+                    sort(edge.second.begin(), edge.second.end());
+                    edge.second.erase(unique(edge.second.begin(), edge.second.end()), edge.second.end());
+                }
+
+            // an edge to a state that another sibling simulates adds nothing, mutually simulating
+            // siblings keep the one with the larger index
+            Simulation simulation = forwardSimulation(quotient, true);
+            for (auto &edges : quotient.post)
+                for (auto &edge : edges)
+                {
+                    vector<int> kept;
+                    for (auto target : edge.second)
+                    {
+                        bool subsumed = false;
+                        for (auto other : edge.second)
+                            if (other != target && simulation(target, other) && (!simulation(other, target) || target < other))
+                            {
+                                subsumed = true;
+                                break;
+                            }
+                        if (!subsumed)
+                            kept.push_back(target);
+                    }
+                    edge.second.swap(kept);
+                }
+
+            // backward simulation is forward simulation of the reversed automata with the initial state as the only
+            // final one, p' backward simulates p when every word leading to p also leads to p'. a source of q on a
+            // that another source backward simulates adds nothing, ties again keep the larger index
+            LambdaFreeView reversed;
+            reversed.initialState = quotient.initialState;
+            reversed.finalStates.assign(blockCount, 0);
+            if (blockCount)
+                reversed.finalStates[quotient.initialState] = 1;
+            reversed.post.resize(blockCount);
+            for (int state = 0; state < blockCount; state++)
+                for (const auto &edge : quotient.post[state])
+                    for (auto target : edge.second)
+                        reversed.post[target][edge.first].push_back(state);
+            Simulation backwardSimulation = forwardSimulation(reversed, true);
+            for (int state = 0; state < blockCount; state++)
+                for (auto &edge : quotient.post[state])
+                {
+                    vector<int> kept;
+                    for (auto target : edge.second)
+                    {
+                        bool subsumed = false;
+                        for (auto other : reversed.post[target][edge.first])
+                            if (other != state && backwardSimulation(state, other) && (!backwardSimulation(other, state) || state < other))
+                            {
+                                subsumed = true;
+                                break;
+                            }
+                        if (!subsumed)
+                            kept.push_back(target);
+                    }
+                    edge.second.swap(kept);
+                }
+
+            // keep only states that are reachable and can still reach a final state
+            vector<vector<int>> predecessors(blockCount);
+            for (int state = 0; state < blockCount; state++)
+                for (const auto &edge : quotient.post[state])
+                    for (auto target : edge.second)
+                        predecessors[target].push_back(state);
+            vector<char> reachable(blockCount, 0), live(blockCount, 0);
+            vector<int> stateStack;
+            if (blockCount)
+            {
+                reachable[quotient.initialState] = 1;
+                stateStack.push_back(quotient.initialState);
+            }
+            while (!stateStack.empty())
+            {
+                int state = stateStack.back();
+                stateStack.pop_back();
+                for (const auto &edge : quotient.post[state])
+                    for (auto target : edge.second)
+                        if (!reachable[target])
+                        {
+                            reachable[target] = 1;
+                            stateStack.push_back(target);
+                        }
+            }
+            for (int state = 0; state < blockCount; state++)
+                if (quotient.finalStates[state])
+                {
+                    live[state] = 1;
+                    stateStack.push_back(state);
+                }
+            while (!stateStack.empty())
+            {
+                int state = stateStack.back();
+                stateStack.pop_back();
+                for (auto predecessor : predecessors[state])
+                    if (!live[predecessor])
+                    {
+                        live[predecessor] = 1;
+                        stateStack.push_back(predecessor);
+                    }
+            }
+
+            NFA reduced(0, lambdaCharacter, string(lambdaString.begin(), lambdaString.end()));
+            vector<int> stateEncoding(blockCount, -1);
+            int encodingIndex = 0;
+            for (int state = 0; state < blockCount; state++)
+                if (state == quotient.initialState || (reachable[state] && live[state]))
+                {
+                    stateEncoding[state] = encodingIndex;
+                    reduced.addState(encodingIndex++);
+                }
+            reduced.setInitialState(blockCount ? stateEncoding[quotient.initialState] : 0);
+            if (!blockCount)
+                reduced.addState(0);
+
+            size_t transitionCount = 0;
+            for (int state = 0; state < blockCount; state++)
+            {
+                if (stateEncoding[state] == -1)
+                    continue;
+                if (quotient.finalStates[state])
+                    reduced.addFinalState(stateEncoding[state]);
+                for (const auto &edge : quotient.post[state])
+                    for (auto target : edge.second)
+                        if (stateEncoding[target] != -1)
+                        {
+                            reduced.addTransition(stateEncoding[state], stateEncoding[target], edge.first);
+                            transitionCount++;
+                        }
+            }
+
+            if (report != nullptr)
+            {
+                report->originalStates = states.size();
+                report->originalTransitions = 0;
+                for (auto itt = transitions.begin(); itt != transitions.end(); itt++)
+                    for (auto it = (itt->second).begin(); it != (itt->second).end(); it++)
+                        report->originalTransitions += (it->second).size();
+                report->bisimulationStates = blockCount;
+                report->reducedStates = encodingIndex;
+                report->reducedTransitions = transitionCount;
+            }
+            return reduced;
+        }
+
+        // subset construction over lambda closures that gives up once the budget is exceeded,
+        // defined after CompactNFA which it runs on
+        DeterminizationResult turnDeterministic(const DeterminizationBudget &budget) const;
+
+        // the same construction without a budget
+        DFA turnDeterministic() const { return turnDeterministic(DeterminizationBudget()).automata; }
+    };
+
+    // membership flags over the states of an automata, cleared in O(1) by moving to the next epoch so a
+    // step over a handful of active states does not pay for the whole automata. owned by the caller,
+    // one per thread, and reused across steps and words
+    class StateMarks
+    {
+    private:
+        vector<uint32_t> stamps;
+        uint32_t epoch = 1;
+
+    public:
+        explicit StateMarks(size_t stateCount = 0) : stamps(stateCount, 0) {}
+
+        void clear()
+        {
+            if (++epoch == 0)
+            {
+                fill(stamps.begin(), stamps.end(), 0);
+                epoch = 1;
+            }
+        }
+        // false when the state was already marked since the last clear
+        bool mark(int state)
+        {
+            if (stamps[state] == epoch)
+                return false;
+            stamps[state] = epoch;
+            return true;
+        }
+        size_t size() const { return stamps.size(); }
+    };
+
+    // NFA with its transitions in compressed sparse row form: the edges of state i are
+    // symbols / targets [offsets[i], offsets[i + 1]), sorted by (symbol, target), lambda edges are kept apart
+    class CompactNFA
+    {
+    private:
+        int stateCount = 0;
+        int initialState = 0;
+        vector<uint32_t> offsets;
+        vector<char> symbols;
+        vector<int> targets;
+        vector<uint32_t> lambdaOffsets;
+        vector<int> lambdaTargets;
+        vector<char> finalStates;
+        vector<int> stateNames;
+        vector<char> lambdaString;
+        bool initialIsDead = false;
+
+        // adds the lambda closure of the states to the set and sorts it, the states of the set have to be
+        // the ones marked since the last clear, the set itself doubles as the work list
+        void closure(vector<int> &stateSet, StateMarks &marks) const
+        {
+            for (size_t index = 0; index < stateSet.size(); index++)
+            {
+                int state = stateSet[index];
+                for (uint32_t edge = lambdaOffsets[state]; edge < lambdaOffsets[state + 1]; edge++)
+                    if (marks.mark(lambdaTargets[edge]))
+                        stateSet.push_back(lambdaTargets[edge]);
+            }
+            sort(stateSet.begin(), stateSet.end());
+        }
+
+        // visitedAt[state] is the depth of the path segment the state was entered in, a state is entered
+        // at most once between two consumed characters. entering overwrites the mark of an outer segment
+        // and leaving restores it, so one array serves every depth
+        void DFS(const string &word, size_t depth, int currentState, vector<int> &currentPath,
+                 vector<size_t> &visitedAt, vector<vector<int>> &solutionPaths) const
+        {
+            if (depth == word.size() && finalStates[currentState])
+                solutionPaths.emplace_back(currentPath);
+
+            auto enter = [&](int nextState, size_t nextDepth)
+            {
+                size_t outerMark = visitedAt[nextState];
+                visitedAt[nextState] = nextDepth;
+                currentPath.push_back(nextState);
+                DFS(word, nextDepth, nextState, currentPath, visitedAt, solutionPaths);
+                currentPath.pop_back();
+                visitedAt[nextState] = outerMark;
+            };
+
+            for (uint32_t edge = lambdaOffsets[currentState]; edge < lambdaOffsets[currentState + 1]; edge++)
+                if (visitedAt[lambdaTargets[edge]] != depth)
+                    enter(lambdaTargets[edge], depth);
+
+            if (depth == word.size())
+                return;
+            auto first = symbols.begin() + offsets[currentState], last = symbols.begin() + offsets[currentState + 1];
+            auto range = equal_range(first, last, word[depth]);
+            for (auto its = range.first; its != range.second; its++)
+                enter(targets[its - symbols.begin()], depth + 1);
+        }
+
+    public:
+        explicit CompactNFA(const NFA &nfa)
+        {
+            const set<int> &states = nfa.getStateSet();
+            const map<int, map<int, set<char>>> &transitions = nfa.getTransitionTable();
+            lambdaString = nfa.getLambdaString();
+            char lambdaCharacter = nfa.getLambdaCharacter();
+
+            map<int, int> stateEncoding;
+            for (auto its = states.begin(); its != states.end(); its++)
+            {
+                stateEncoding.insert(pair<int, int>(*its, stateCount++));
+                stateNames.emplace_back(*its);
+            }
+            auto iti = stateEncoding.find(nfa.getInitialState());
+            if (iti == stateEncoding.end())
+                throw(runtime_error("Could not find initial state."));
+            initialState = iti->second;
+
+            finalStates.assign(stateCount, 0);
+            set<int> nfaFinalStates = nfa.getFinalStates();
+            for (auto itf = nfaFinalStates.begin(); itf != nfaFinalStates.end(); itf++)
+                if (stateEncoding.find(*itf) != stateEncoding.end())
+                    finalStates[stateEncoding[*itf]] = 1;
+
+            // edges into dead states are never stored, a state set only keeps states that can still accept
+            // and becomes empty as soon as the word can no longer be accepted
+            set<int> deadStates = nfa.getDeadStates();
+            initialIsDead = deadStates.find(nfa.getInitialState()) != deadStates.end();
+            vector<char> isDead(stateCount, 0);
+            for (auto state : deadStates)
+                isDead[stateEncoding[state]] = 1;
+
+            // count edges per state first so every array is allocated exactly once
+            offsets.assign(stateCount + 1, 0);
+            lambdaOffsets.assign(stateCount + 1, 0);
+            for (auto itt = transitions.begin(); itt != transitions.end(); itt++)
+                for (auto it = (itt->second).begin(); it != (itt->second).end(); it++)
+                    if (!isDead[stateEncoding[it->first]])
+                        for (auto itc = (it->second).begin(); itc != (it->second).end(); itc++)
+                            if (*itc == lambdaCharacter)
+                                lambdaOffsets[stateEncoding[itt->first] + 1]++;
+                            else
+                                offsets[stateEncoding[itt->first] + 1]++;
+            for (int state = 0; state < stateCount; state++)
+            {
+                offsets[state + 1] += offsets[state];
+                lambdaOffsets[state + 1] += lambdaOffsets[state];
+            }
+
+            symbols.resize(offsets[stateCount]);
+            targets.resize(offsets[stateCount]);
+            lambdaTargets.resize(lambdaOffsets[stateCount]);
+            vector<uint32_t> position(offsets.begin(), offsets.end() - 1), lambdaPosition(lambdaOffsets.begin(), lambdaOffsets.end() - 1);
+            for (auto itt = transitions.begin(); itt != transitions.end(); itt++)
+            {
+                int state = stateEncoding[itt->first];
+                vector<pair<char, int>> edges;
+                for (auto it = (itt->second).begin(); it != (itt->second).end(); it++)
+                    if (!isDead[stateEncoding[it->first]])
+                        for (auto itc = (it->second).begin(); itc != (it->second).end(); itc++)
+                            if (*itc == lambdaCharacter)
+                                lambdaTargets[lambdaPosition[state]++] = stateEncoding[it->first];
+                            else
+                                edges.emplace_back(*itc, stateEncoding[it->first]);
+                sort(edges.begin(), edges.end());
+                for (const auto &edge : edges)
+                {
+                    symbols[position[state]] = edge.first;
+                    targets[position[state]++] = edge.second;
+                }
+            }
+        }
+
+        // scratch space for getStartSet and step, sized for this automata
+        StateMarks makeMarks() const { return StateMarks(stateCount); }
+
+        // closed set of states the automata starts in
+        vector<int> getStartSet(StateMarks &marks) const
+        {
+            if (initialIsDead)
+                return vector<int>();
+            marks.clear();
+            marks.mark(initialState);
+            vector<int> start{initialState};
+            closure(start, marks);
+            return start;
+        }
+        vector<int> getStartSet() const
+        {
+            StateMarks marks = makeMarks();
+            return getStartSet(marks);
+        }
+
+        // closed set reached from a closed set by reading one character, the work is proportional to the
+        // states and edges involved as long as the caller reuses its marks
+        vector<int> step(const vector<int> &current, char character, StateMarks &marks) const
+        {
+            vector<int> next;
+            marks.clear();
+            for (auto state : current)
+            {
+                auto first = symbols.begin() + offsets[state], last = symbols.begin() + offsets[state + 1];
+                auto range = equal_range(first, last, character);
+                for (auto its = range.first; its != range.second; its++)
+                    if (marks.mark(targets[its - symbols.begin()]))
+                        next.push_back(targets[its - symbols.begin()]);
+            }
+            closure(next, marks);
+            return next;
+        }
+        vector<int> step(const vector<int> &current, char character) const
+        {
+            StateMarks marks = makeMarks();
+            return step(current, character, marks);
+        }
+
+        bool containsFinalState(const vector<int> &current) const
+        {
+            for (auto state : current)
+                if (finalStates[state])
+                    return true;
+            return false;
+        }
+
+        bool isLambdaString(string_view str) const
+        {
+            return str.size() == lambdaString.size() && equal(str.begin(), str.end(), lambdaString.begin());
+        }
+
+        // set simulation, linear in the length of the word
+        bool evaluateString(string_view str) const
+        {
+            StateMarks marks = makeMarks();
+            vector<int> current = getStartSet(marks);
+            if (!isLambdaString(str))
+                for (size_t index = 0; index < str.size() && !current.empty(); index++)
+                    current = step(current, str[index], marks);
+            return containsFinalState(current);
+        }
+
+        vector<vector<int>> evaluateStringWithPath(const string &str) const
+        {
+            string word = isLambdaString(str) ? string() : str;
+            vector<vector<int>> solutions, answer;
+            vector<int> currentPath{initialState};
+            vector<size_t> visitedAt(stateCount, SIZE_MAX);
+            visitedAt[initialState] = 0;
+            DFS(word, 0, initialState, currentPath, visitedAt, solutions);
+            for (auto &solution : solutions)
+            {
+                for (auto &state : solution)
+                    state = stateNames[state];
+                answer.emplace_back(solution);
+            }
+            return answer;
+        }
+
+        // subset construction over lambda closures, NFA::turnDeterministic runs on it
+        DFA turnDeterministic() const { return turnDeterministic(DeterminizationBudget()).automata; }
+
+        // same construction, stopped as soon as the next subset would exceed the budget
+        DeterminizationResult turnDeterministic(const DeterminizationBudget &budget) const
+        {
+            DeterminizationResult result;
+            DFA &automata = result.automata;
+            automata.setLambdaString(lambdaString);
+            StateMarks marks = makeMarks();
+            vector<int> start = getStartSet(marks);
+
+            // every subset is stored twice (index key and work list) next to its DFA state,
+            // every DFA transition costs a target node and a character node
+            auto stateCost = [](size_t subsetSize)
+            {
+                return 2 * (sizeof(vector<int>) + subsetSize * sizeof(int)) + DFA::treeNodeSize(sizeof(pair<const vector<int>, int>)) +
+                       2 * DFA::treeNodeSize(sizeof(int));
+            };
+            const size_t transitionCost = DFA::treeNodeSize(sizeof(pair<const int, set<char>>)) + DFA::treeNodeSize(sizeof(char));
+
+            map<vector<int>, int> generatedStateEncoding;
+            vector<vector<int>> generatedStates{start};
+            generatedStateEncoding.insert(pair<vector<int>, int>(start, 0));
+            automata.addState(0);
+            result.estimatedMemory = stateCost(start.size());
+
+            vector<pair<char, int>> edges;
+            for (size_t currentState = 0; currentState < generatedStates.size() && result.complete; currentState++)
+            {
+                edges.clear();
+                for (auto state : generatedStates[currentState])
+                    for (uint32_t edge = offsets[state]; edge < offsets[state + 1]; edge++)
+                        edges.emplace_back(symbols[edge], targets[edge]);
+                sort(edges.begin(), edges.end());
+                edges.erase(unique(edges.begin(), edges.end()), edges.end());
+
+                for (size_t first = 0; first < edges.size();)
+                {
+                    size_t last = first;
+                    vector<int> nextState;
+                    marks.clear();
+                    while (last < edges.size() && edges[last].first == edges[first].first)
+                    {
+                        marks.mark(edges[last].second);
+                        nextState.push_back(edges[last++].second);
+                    }
+                    closure(nextState, marks);
+
+                    auto itg = generatedStateEncoding.find(nextState);
+                    if (itg == generatedStateEncoding.end())
+                    {
+                        size_t cost = stateCost(nextState.size()) + transitionCost;
+                        if (generatedStates.size() >= budget.maximumStates || result.estimatedMemory + cost > budget.maximumMemory)
+                        {
+                            result.complete = false;
+                            break;
+                        }
+                        result.estimatedMemory += stateCost(nextState.size());
+                        itg = generatedStateEncoding.insert(pair<vector<int>, int>(nextState, generatedStates.size())).first;
+                        automata.addState(generatedStates.size());
+                        generatedStates.push_back(nextState);
+                    }
+                    else if (result.estimatedMemory + transitionCost > budget.maximumMemory)
+                    {
+                        result.complete = false;
+                        break;
+                    }
+                    result.estimatedMemory += transitionCost;
+                    automata.addTransition(currentState, itg->second, edges[first].first);
+                    first = last;
+                }
+            }
+            result.generatedStates = generatedStates.size();
+
+            for (size_t state = 0; state < generatedStates.size(); state++)
+                for (auto subsetState : generatedStates[state])
+                    if (finalStates[subsetState])
+                    {
+                        automata.addFinalState(state);
+                        break;
+                    }
+            automata.setInitialState(0);
+            return result;
+        }
+
+        int getStateCount() const { return stateCount; }
+        size_t getTransitionCount() const { return targets.size() + lambdaTargets.size(); }
+        size_t getLambdaTransitionCount() const { return lambdaTargets.size(); }
+        const vector<char> &getLambdaString() const { return lambdaString; }
+        size_t memoryUsage() const
+        {
+            return sizeof(*this) + offsets.capacity() * sizeof(uint32_t) + symbols.capacity() * sizeof(char) +
+                   targets.capacity() * sizeof(int) + lambdaOffsets.capacity() * sizeof(uint32_t) +
+                   lambdaTargets.capacity() * sizeof(int) + finalStates.capacity() + stateNames.capacity() * sizeof(int) +
+                   lambdaString.capacity();
+        }
+    };
+
+    inline DeterminizationResult NFA::turnDeterministic(const DeterminizationBudget &budget) const
+    {
+        return CompactNFA(*this).turnDeterministic(budget);
+    }
+
+    // set simulation for NFAs with at most 64 states: a state set is one machine word and reading a
+    // character ORs together the successor masks of its states, lambda closures are folded into the
+    // masks up front and bytes with identical columns share a class
+    class BitParallelNFA
+    {
+    private:
+        int stateCount = 0;
+        uint64_t startMask = 0;
+        uint64_t finalMask = 0;
+        array<unsigned char, 256> symbolClass{};
+        int classCount = 0;
+        // class x state -> closed successor set
+        vector<uint64_t> follow;
+        vector<char> lambdaString;
+
+    public:
+        static const int maximumStates = 64;
+
+        explicit BitParallelNFA(const CompactNFA &nfa) : stateCount(nfa.getStateCount())
+        {
+            if (stateCount > maximumStates)
+                throw(runtime_error("Automata has too many states for a bit parallel simulation."));
+            StateMarks marks = nfa.makeMarks();
+            for (auto state : nfa.getStartSet(marks))
+                startMask |= uint64_t(1) << state;
+            for (int state = 0; state < stateCount; state++)
+                if (nfa.containsFinalState(vector<int>{state}))
+                    finalMask |= uint64_t(1) << state;
+            lambdaString = nfa.getLambdaString();
+
+            // the closure of a union is the union of the closures, so one mask per (byte, state) is enough
+            map<vector<uint64_t>, int> classEncoding;
+            vector<uint64_t> column(stateCount);
+            for (int byte = 0; byte < 256; byte++)
+            {
+                for (int state = 0; state < stateCount; state++)
+                {
+                    column[state] = 0;
+                    for (auto next : nfa.step(vector<int>{state}, (char)byte, marks))
+                        column[state] |= uint64_t(1) << next;
+                }
+                auto itc = classEncoding.find(column);
+                if (itc == classEncoding.end())
+                {
+                    itc = classEncoding.insert(make_pair(column, classCount++)).first;
+                    follow.insert(follow.end(), column.begin(), column.end());
+                }
+                symbolClass[byte] = itc->second;
+            }
+        }
+        explicit BitParallelNFA(const NFA &nfa) : BitParallelNFA(CompactNFA(nfa)) {}
+
+        bool evaluateString(string_view str) const
+        {
+            uint64_t current = startMask;
+            if (str.size() != lambdaString.size() || !equal(str.begin(), str.end(), lambdaString.begin()))
+                for (size_t index = 0; index < str.size() && current; index++)
+                {
+                    const uint64_t *successors = &follow[symbolClass[(unsigned char)str[index]] * stateCount];
+                    uint64_t next = 0;
+                    for (uint64_t remaining = current; remaining; remaining &= remaining - 1)
+                        next |= successors[FA_LOWEST_BIT(remaining)];
+                    current = next;
+                }
+            return (current & finalMask) != 0;
+        }
+
+        int getStateCount() const { return stateCount; }
+        int getClassCount() const { return classCount; }
+        size_t memoryUsage() const { return sizeof(*this) + follow.capacity() * sizeof(uint64_t) + lambdaString.capacity(); }
+    };
+
+    // DFA built on demand from the subsets the words actually reach, the cache is flushed whenever
+    // it grows past its memory limit so the footprint stays bounded whatever the NFA looks like
+    class LazyDFA
+    {
+    private:
+        CompactNFA nfa;
+        StateMarks marks;
+        size_t maximumMemory;
+        map<vector<int>, int> stateEncoding;
+        vector<vector<int>> cachedStates;
+        // cached state x byte, -1 while the transition was not computed yet
+        vector<array<int, 256>> cachedTransitions;
+        vector<char> cachedFinal;
+        int startState = -1;
+        size_t cacheMemory = 0;
+        size_t flushCount = 0;
+
+        static size_t stateCost(size_t subsetSize)
+        {
+            return 2 * (sizeof(vector<int>) + subsetSize * sizeof(int)) + sizeof(array<int, 256>) + 1 +
+                   DFA::treeNodeSize(sizeof(pair<const vector<int>, int>));
+        }
+
+        void flush()
+        {
+            stateEncoding.clear();
+            cachedStates.clear();
+            cachedTransitions.clear();
+            cachedFinal.clear();
+            startState = -1;
+            cacheMemory = 0;
+            flushCount++;
+        }
+
+        // returns the cached index of the subset, adding it may flush every other state
+        int addState(const vector<int> &subset)
+        {
+            auto its = stateEncoding.find(subset);
+            if (its != stateEncoding.end())
+                return its->second;
+            if (!cachedStates.empty() && cacheMemory + stateCost(subset.size()) > maximumMemory)
+                flush();
+            cacheMemory += stateCost(subset.size());
+            stateEncoding.insert(pair<vector<int>, int>(subset, cachedStates.size()));
+            cachedStates.push_back(subset);
+            cachedTransitions.emplace_back();
+            cachedTransitions.back().fill(-1);
+            cachedFinal.push_back(nfa.containsFinalState(subset));
+            return cachedStates.size() - 1;
+        }
+
+    public:
+        explicit LazyDFA(const NFA &automata, size_t maximumMemory = 1 << 20)
+            : nfa(automata), marks(nfa.makeMarks()), maximumMemory(maximumMemory) {}
+
+        // not const, every call may extend or flush the cache
+        bool evaluateString(string_view str)
+        {
+            if (startState < 0)
+                startState = addState(nfa.getStartSet(marks));
+            int currentState = startState;
+            if (nfa.isLambdaString(str))
+                return cachedFinal[currentState];
+            for (size_t index = 0; index < str.size(); index++)
+            {
+                int nextState = cachedTransitions[currentState][(unsigned char)str[index]];
+                if (nextState < 0)
+                {
+                    size_t flushesBefore = flushCount;
+                    vector<int> nextSubset = nfa.step(cachedStates[currentState], str[index], marks);
+                    nextState = addState(nextSubset);
+                    // after a flush the current state is gone, so the edge can not be cached
+                    if (flushCount == flushesBefore)
+                        cachedTransitions[currentState][(unsigned char)str[index]] = nextState;
+                }
+                currentState = nextState;
+                // dead states are pruned from the NFA, the empty subset is the only one that can not accept
+                if (cachedStates[currentState].empty())
+                    return false;
+            }
+            return cachedFinal[currentState];
+        }
+
+        size_t getCachedStateCount() const { return cachedStates.size(); }
+        size_t getFlushCount() const { return flushCount; }
+        size_t memoryUsage() const { return sizeof(*this) + cacheMemory + nfa.memoryUsage() + marks.size() * sizeof(uint32_t); }
+    };
+
+    // picks the fastest engine that fits the budget: a full dense DFA when determinization finishes,
+    // a bit parallel simulation when the NFA fits in a machine word, a lazy DFA when at least a few
+    // subsets fit in memory, plain set simulation otherwise
+    class Matcher
+    {
+    public:
+        enum class Engine
+        {
+            DFA,
+            BitParallelNFA,
+            LazyDFA,
+            NFASimulation
+        };
+
+    private:
+        Engine engine = Engine::NFASimulation;
+        string reason;
+        unique_ptr<DenseDFA> denseAutomata;
+        unique_ptr<BitParallelNFA> bitParallelAutomata;
+        unique_ptr<LazyDFA> lazyAutomata;
+        unique_ptr<CompactNFA> compactAutomata;
+
+    public:
+        // a lazy cache smaller than this many worst case subsets would thrash on every word
+        static const size_t minimumLazyStates = 16;
+
+        explicit Matcher(const DFA &dfa) : engine(Engine::DFA)
+        {
+            DFA automata = dfa;
+            automata.minimize();
+            denseAutomata = make_unique<DenseDFA>(automata);
+            reason = "deterministic input, " + to_string(denseAutomata->getStateCount()) + " states over " +
+                     to_string(denseAutomata->getClassCount()) + " symbol classes";
+        }
+
+        Matcher(const NFA &nfa, const DeterminizationBudget &budget)
+        {
+            CompactNFA compact(nfa);
+            string shape = to_string(compact.getStateCount()) + " NFA states and " +
+                           to_string(compact.getLambdaTransitionCount()) + " lambda transitions";
+            DeterminizationResult result = compact.turnDeterministic(budget);
+            if (result.complete)
+            {
+                engine = Engine::DFA;
+                reason = "determinization finished with " + to_string(result.generatedStates) + " states from " + shape;
+                DFA automata = result.automata;
+                automata.minimize();
+                denseAutomata = make_unique<DenseDFA>(automata);
+                return;
+            }
+            string stopped = "determinization stopped after " + to_string(result.generatedStates) + " states from " + shape;
+
+            // the whole state set is one word, lambda closures cost nothing at match time
+            if (compact.getStateCount() <= BitParallelNFA::maximumStates)
+            {
+                auto automata = make_unique<BitParallelNFA>(compact);
+                if (automata->memoryUsage() <= budget.maximumMemory)
+                {
+                    engine = Engine::BitParallelNFA;
+                    reason = stopped + ", the states fit in one machine word, " + to_string(automata->getClassCount()) + " symbol classes";
+                    bitParallelAutomata = move(automata);
+                    return;
+                }
+            }
+
+            size_t worstState = 2 * (sizeof(vector<int>) + compact.getStateCount() * sizeof(int)) + sizeof(array<int, 256>) +
+                                DFA::treeNodeSize(sizeof(pair<const vector<int>, int>));
+            if (budget.maximumMemory / worstState >= minimumLazyStates)
+            {
+                engine = Engine::LazyDFA;
+                reason = stopped + ", caching subsets lazily";
+                lazyAutomata = make_unique<LazyDFA>(nfa, budget.maximumMemory);
+                return;
+            }
+
+            engine = Engine::NFASimulation;
+            reason = stopped + ", memory too small for a subset cache";
+            compactAutomata = make_unique<CompactNFA>(compact);
+        }
+
+        bool evaluateString(string_view str)
+        {
+            switch (engine)
+            {
+            case Engine::DFA:
+                return denseAutomata->evaluateString(str);
+            case Engine::BitParallelNFA:
+                return bitParallelAutomata->evaluateString(str);
+            case Engine::LazyDFA:
+                return lazyAutomata->evaluateString(str);
+            default:
+                return compactAutomata->evaluateString(str);
+            }
+        }
+
+        Engine getEngine() const { return engine; }
+        const string &getReason() const { return reason; }
+
+        friend ostream &operator<<(ostream &out, Engine engine)
+        {
+            switch (engine)
+            {
+            case Engine::DFA:
+                return out << "dfa";
+            case Engine::BitParallelNFA:
+                return out << "bit parallel nfa";
+            case Engine::LazyDFA:
+                return out << "lazy dfa";
+            default:
+                return out << "nfa simulation";
+            }
+        }
+    };
+
+    // many automata merged into one table: a combined state is the tuple of the component states that
+    // can still accept and carries the ids of the components that accept in it, so one pass over a word
+    // answers for every automaton. the empty string is the empty word, lambda strings are not used
+    class AutomataSet
+    {
+    private:
+        vector<DenseDFA> automata;
+        bool combined = false;
+        array<unsigned char, 256> symbolClass{};
+        int classCount = 0;
+        int stateCount = 0;
+        int initialState = 0;
+        int deadState = 0;
+        vector<int> table;
+        // ids accepted in state i are matchIds[matchOffsets[i], matchOffsets[i + 1])
+        vector<uint32_t> matchOffsets;
+        vector<int> matchIds;
+
+        static int runComponent(const DenseDFA &dfa, string_view str)
+        {
+            int state = dfa.getInitialState();
+            for (size_t index = 0; index < str.size() && state != dfa.getDeadState(); index++)
+                state = dfa.getNextState(state, str[index]);
+            return state;
+        }
+
+    public:
+        // every automaton is minimized first, a smaller component keeps the product smaller
+        int add(const DenseDFA &dfa)
+        {
+            automata.push_back(dfa.minimize());
+            combined = false;
+            return automata.size() - 1;
+        }
+        int add(const DFA &dfa) { return add(DenseDFA(dfa)); }
+        int add(const NFA &nfa) { return add(DenseDFA(CompactNFA(nfa).turnDeterministic())); }
+
+        // builds the product over the byte classes every component agrees on, when it would need more than
+        // maximumStates rows the set keeps matching the components one after the other instead
+        bool compile(size_t maximumStates = 1 << 20)
+        {
+            // two bytes share a class when they share a class in every component
+            map<vector<int>, int> classEncoding;
+            vector<int> representative;
+            for (int character = 0; character < 256; character++)
+            {
+                vector<int> signature;
+                for (const auto &dfa : automata)
+                    signature.push_back(dfa.getSymbolClass(character));
+                auto itc = classEncoding.find(signature);
+                if (itc == classEncoding.end())
+                {
+                    itc = classEncoding.insert(make_pair(signature, classEncoding.size())).first;
+                    representative.push_back(character);
+                }
+                symbolClass[character] = itc->second;
+            }
+            classCount = classEncoding.size();
+
+            // component states get global numbers so a combined state is a sorted vector of ints
+            vector<int> base{0};
+            for (const auto &dfa : automata)
+                base.push_back(base.back() + dfa.getStateCount() + 1);
+            vector<int> componentOf(base.back());
+            for (size_t component = 0; component < automata.size(); component++)
+                fill(componentOf.begin() + base[component], componentOf.begin() + base[component + 1], component);
+
+            vector<int> start;
+            for (size_t component = 0; component < automata.size(); component++)
+                if (automata[component].getInitialState() != automata[component].getDeadState())
+                    start.push_back(base[component] + automata[component].getInitialState());
+
+            map<vector<int>, int> generatedStateEncoding;
+            vector<vector<int>> generatedStates;
+            vector<int> generatedTable;
+            // the empty tuple is the dead state, it always gets row 0 so the loop below never expands it
+            generatedStateEncoding.insert(make_pair(vector<int>(), 0));
+            generatedStates.emplace_back();
+            if (!start.empty())
+            {
+                generatedStateEncoding.insert(make_pair(start, 1));
+                generatedStates.push_back(start);
+            }
+
+            combined = true;
+            for (size_t currentState = 1; currentState < generatedStates.size(); currentState++)
+            {
+                if (generatedStates.size() > maximumStates)
+                {
+                    combined = false;
+                    break;
+                }
+                generatedTable.resize(generatedStates.size() * classCount, 0);
+                for (int currentClass = 0; currentClass < classCount; currentClass++)
+                {
+                    vector<int> nextState;
+                    for (auto state : generatedStates[currentState])
+                    {
+                        int component = componentOf[state];
+                        const DenseDFA &dfa = automata[component];
+                        int target = dfa.getNextState(state - base[component], representative[currentClass]);
+                        if (target != dfa.getDeadState())
+                            nextState.push_back(base[component] + target);
+                    }
+                    auto itg = generatedStateEncoding.find(nextState);
+                    if (itg == generatedStateEncoding.end())
+                    {
+                        itg = generatedStateEncoding.insert(make_pair(nextState, generatedStates.size())).first;
+                        generatedStates.push_back(nextState);
+                    }
+                    generatedTable[currentState * classCount + currentClass] = itg->second;
+                }
+            }
+
+            if (!combined)
+            {
+                table.clear();
+                matchOffsets.clear();
+                matchIds.clear();
+                return false;
+            }
+            generatedTable.resize(generatedStates.size() * classCount, 0);
+            table.swap(generatedTable);
+            stateCount = generatedStates.size();
+            deadState = 0;
+            initialState = start.empty() ? deadState : 1;
+            matchOffsets.assign(1, 0);
+            matchIds.clear();
+            for (const auto &generatedState : generatedStates)
+            {
+                for (auto state : generatedState)
+                {
+                    int component = componentOf[state];
+                    if (automata[component].isFinalState(state - base[component]))
+                        matchIds.push_back(component);
+                }
+                matchOffsets.push_back(matchIds.size());
+            }
+            return true;
+        }
+
+        // ids of every automaton accepting the word, in increasing order
+        vector<int> match(string_view str) const
+        {
+            vector<int> answer;
+            if (!combined)
+            {
+                for (size_t component = 0; component < automata.size(); component++)
+                {
+                    int state = runComponent(automata[component], str);
+                    if (state != automata[component].getDeadState() && automata[component].isFinalState(state))
+                        answer.push_back(component);
+                }
+                return answer;
+            }
+
+            int state = initialState;
+            for (size_t index = 0; index < str.size() && state != deadState; index++)
+                state = table[(size_t)state * classCount + symbolClass[(unsigned char)str[index]]];
+            answer.assign(matchIds.begin() + matchOffsets[state], matchIds.begin() + matchOffsets[state + 1]);
+            return answer;
+        }
+
+        bool isCombined() const { return combined; }
+        int getStateCount() const { return stateCount; }
+        int getClassCount() const { return classCount; }
+        size_t getAutomataCount() const { return automata.size(); }
+        size_t getTableSize() const { return table.size() * sizeof(int) + (matchOffsets.size() + matchIds.size()) * sizeof(int); }
     };
 };
@@ -0,0 +1,32 @@
+#include <fstream>
+#include <iostream>
+#include "fa.hpp"
+
+using namespace std;
+using namespace fa;
+
+// usage: generator <dfa file> <output header> <matcher name>
+int main(int argc, char *argv[])
+{
+    if (argc != 4)
+    {
+        cerr << "Usage: " << argv[0] << " <dfa file> <output header> <matcher name>" << endl;
+        return 1;
+    }
+
+    ifstream in(argv[1]);
+    if (!in)
+    {
+        cerr << "Could not open " << argv[1] << endl;
+        return 1;
+    }
+
+    DFA dfa;
+    in >> dfa;
+    dfa.minimize();
+    DenseDFA compiled(dfa);
+
+    ofstream out(argv[2]);
+    compiled.generateMatcher(out, argv[3]);
+    return out ? 0 : 1;
+}
@@ -0,0 +1,228 @@
+#include <chrono>
+#include <thread>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include "protocol.hpp"
+
+using namespace std;
+using namespace fa;
+
+typedef chrono::steady_clock Clock;
+
+void printUsage(const char *program)
+{
+    cerr << "Usage: " << program << " --socket <path> --name <automata> --words <file> [options]" << endl;
+    cerr << "  --op evaluate|paths|cyk|pda" << endl;
+    cerr << "                          request type (default evaluate)" << endl;
+    cerr << "  --batch <count>         words per request (default 64)" << endl;
+    cerr << "  --requests <count>      requests in total (default 10000)" << endl;
+    cerr << "  --pipeline <count>      requests kept in flight per connection (default 16)" << endl;
+    cerr << "  --connections <count>   parallel connections (default 1)" << endl;
+}
+
+struct ConnectionResult
+{
+    vector<double> latencies;
+    size_t accepted = 0;
+    size_t failed = 0;
+    string error;
+};
+
+// keeps `pipeline` requests outstanding, every response that comes back is replaced by a new request
+void runConnection(const string &socketPath, Opcode opcode, const string &name, const vector<string> &words,
+                   size_t batchSize, size_t requestCount, size_t pipeline, size_t wordOffset, ConnectionResult &result)
+{
+    try
+    {
+        FrameSocket connection(connectTo(socketPath));
+        vector<Clock::time_point> sentAt(requestCount);
+        result.latencies.reserve(requestCount);
+        vector<string_view> batch(batchSize);
+        size_t sent = 0, received = 0, wordIndex = wordOffset;
+        string out;
+
+        auto sendMore = [&]()
+        {
+            out.clear();
+            while (sent < requestCount && sent - received < pipeline)
+            {
+                for (auto &word : batch)
+                {
+                    word = words[wordIndex];
+                    wordIndex = (wordIndex + 1 == words.size()) ? 0 : wordIndex + 1;
+                }
+                encodeRequest(out, opcode, sent, name, batch);
+                sentAt[sent++] = Clock::now();
+            }
+            // the server may already answer the first requests of a large batch and block until they are read
+            return out.empty() || connection.writeAllWhileReading(out);
+        };
+
+        if (!sendMore())
+            throw(runtime_error("Could not send requests."));
+        while (received < requestCount)
+        {
+            // responses may already be buffered from while the last batch was written
+            size_t receivedBefore = received;
+            string_view frame;
+            while (connection.nextBufferedFrame(frame))
+            {
+                Response response = decodeResponse(frame);
+                Clock::time_point now = Clock::now();
+                if (response.requestId >= sent)
+                    throw(runtime_error("Unexpected response."));
+                result.latencies.push_back(chrono::duration<double, micro>(now - sentAt[response.requestId]).count());
+                received++;
+                if (response.status != Status::Ok)
+                {
+                    result.failed++;
+                    continue;
+                }
+                // membership answers are one byte per word, paths are non empty for accepted words
+                FrameReader reader(response.body);
+                for (uint32_t index = 0; index < response.count; index++)
+                    if (opcode == Opcode::Paths)
+                    {
+                        uint32_t length = reader.read<uint32_t>();
+                        reader.readBytes(length * sizeof(int32_t));
+                        result.accepted += length != 0;
+                    }
+                    else
+                        result.accepted += reader.read<uint8_t>();
+            }
+            if (received == receivedBefore)
+            {
+                if (!connection.fill())
+                    throw(runtime_error("Server closed the connection."));
+                continue;
+            }
+            if (!sendMore())
+                throw(runtime_error("Could not send requests."));
+        }
+    }
+    catch (const exception &exception)
+    {
+        result.error = exception.what();
+    }
+}
+
+double percentile(const vector<double> &sorted, double fraction)
+{
+    if (sorted.empty())
+        return 0;
+    size_t index = min(sorted.size() - 1, (size_t)(fraction * sorted.size()));
+    return sorted[index];
+}
+
+int main(int argc, char *argv[])
+{
+    string socketPath, name, wordsPath, operation = "evaluate";
+    size_t batchSize = 64, requestCount = 10000, pipeline = 16, connectionCount = 1;
+
+    for (int index = 1; index < argc; index++)
+    {
+        string argument = argv[index];
+        if (index + 1 >= argc)
+        {
+            printUsage(argv[0]);
+            return 1;
+        }
+        if (argument == "--socket")
+            socketPath = argv[++index];
+        else if (argument == "--name")
+            name = argv[++index];
+        else if (argument == "--words")
+            wordsPath = argv[++index];
+        else if (argument == "--op")
+            operation = argv[++index];
+        else if (argument == "--batch")
+            batchSize = stoul(argv[++index]);
+        else if (argument == "--requests")
+            requestCount = stoul(argv[++index]);
+        else if (argument == "--pipeline")
+            pipeline = stoul(argv[++index]);
+        else if (argument == "--connections")
+            connectionCount = stoul(argv[++index]);
+        else
+        {
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+
+    Opcode opcode;
+    if (operation == "evaluate")
+        opcode = Opcode::Evaluate;
+    else if (operation == "paths")
+        opcode = Opcode::Paths;
+    else if (operation == "cyk")
+        opcode = Opcode::Parse;
+    else if (operation == "pda")
+        opcode = Opcode::Pushdown;
+    else
+    {
+        printUsage(argv[0]);
+        return 1;
+    }
+    if (socketPath.empty() || name.empty() || wordsPath.empty() || !batchSize || !pipeline || !connectionCount)
+    {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    ifstream in(wordsPath);
+    if (!in)
+    {
+        cerr << "Could not open " << wordsPath << endl;
+        return 1;
+    }
+    vector<string> words;
+    string word;
+    while (getline(in, word))
+        words.push_back(word);
+    if (words.empty())
+    {
+        cerr << "No words in " << wordsPath << endl;
+        return 1;
+    }
+
+    vector<ConnectionResult> results(connectionCount);
+    vector<thread> connections;
+    Clock::time_point start = Clock::now();
+    for (size_t index = 0; index < connectionCount; index++)
+    {
+        size_t share = requestCount / connectionCount + (index < requestCount % connectionCount);
+        connections.emplace_back(runConnection, cref(socketPath), opcode, cref(name), cref(words), batchSize, share,
+                                 pipeline, (index * batchSize) % words.size(), ref(results[index]));
+    }
+    for (auto &connection : connections)
+        connection.join();
+    double seconds = chrono::duration<double>(Clock::now() - start).count();
+
+    vector<double> latencies;
+    size_t accepted = 0, failed = 0;
+    for (const auto &result : results)
+    {
+        if (!result.error.empty())
+        {
+            cerr << result.error << endl;
+            return 1;
+        }
+        latencies.insert(latencies.end(), result.latencies.begin(), result.latencies.end());
+        accepted += result.accepted;
+        failed += result.failed;
+    }
+    sort(latencies.begin(), latencies.end());
+
+    size_t wordCount = (latencies.size() - failed) * batchSize;
+    cout << fixed << setprecision(1);
+    cout << "requests: " << latencies.size() << " (" << failed << " failed), words: " << wordCount
+         << ", accepted: " << accepted << endl;
+    cout << "time: " << seconds * 1000 << " ms, " << latencies.size() / seconds << " requests/s, "
+         << wordCount / seconds << " words/s" << endl;
+    cout << "latency (us): p50 " << percentile(latencies, 0.5) << ", p90 " << percentile(latencies, 0.9)
+         << ", p99 " << percentile(latencies, 0.99) << ", p99.9 " << percentile(latencies, 0.999)
+         << ", max " << (latencies.empty() ? 0 : latencies.back()) << endl;
+    return 0;
+}
@@ -1,6 +1,7 @@
 #include <fstream>
 #include <iostream>
-#include "fa.hpp"
+#include "automata.hpp"
+#include "regex.hpp"
 
 using namespace std;
 using namespace fa;
@@ -16,10 +17,18 @@ int main()
     ifstream nin("tests/cnfa.txt");
     nin >> nfa;
     DFA converted = nfa.turnDeterministic();
+    CompactNFA compact(nfa);
 
     cout << "Task 1: " << endl;
     cout << "NFA: " << endl
          << nfa << endl;
+    cout << "Memory usage: " << nfa.memoryUsage() << " bytes as NFA, "
+         << compact.memoryUsage() << " bytes in CSR form" << endl
+         << endl;
+    ReductionReport report;
+    nfa.reduce(&report);
+    cout << "Reduction: " << endl
+         << report << endl;
     dfa.minimize();
     cout << "Converted DFA: " << endl
          << converted << endl;
@@ -64,5 +73,56 @@ int main()
     dfa.minimize();
     cout << "Minimized DFA: " << endl
          << dfa << endl;
+
+    DenseDFA compiled(dfa);
+    cout << "Compiled DFA: " << endl
+         << compiled << endl;
+
+    // identifiers over Latin, Greek, Cyrillic and CJK letters, a few ranges instead of thousands of edges
+    RangeDFA identifier;
+    int start = identifier.addState(), inside = identifier.addState();
+    identifier.addFinalState(inside);
+    vector<pair<uint32_t, uint32_t>> letters{{'A', 'Z'}, {'a', 'z'}, {0xC0, 0x24F}, {0x370, 0x3FF}, {0x400, 0x4FF}, {0x4E00, 0x9FFF}};
+    for (const auto &letter : letters)
+    {
+        identifier.addRange(start, letter.first, letter.second, inside);
+        identifier.addRange(inside, letter.first, letter.second, inside);
+    }
+    identifier.addRange(inside, '0', '9', inside);
+    DFA identifierBytes = identifier.toByteDFA();
+    identifierBytes.minimize();
+    cout << "Task 3: " << endl;
+    cout << "Identifier ranges: " << identifier.getRangeCount() << endl;
+    cout << "UTF-8 DFA: " << endl
+         << DenseDFA(identifierBytes) << endl;
+
+    cout << "Task 4: " << endl;
+    PlannedAutomata plannedDFA(dfa), plannedNFA(nfa);
+    cout << "DFA engine: " << plannedDFA.getEngine() << " (" << plannedDFA.getReason() << ")" << endl;
+    cout << "NFA engine: " << plannedNFA.getEngine() << " (" << plannedNFA.getReason() << ")" << endl;
+
+    // regex DFAs have no lambda string, '-' is an ordinary character and the empty string the empty word
+    DFA dashes = Regex("a-b|-*").toDFA();
+    DenseDFA compiledDashes(dashes);
+    for (string word : {"a-b", "-", "--", "", "ab"})
+        cout << "Regex a-b|-* on \"" << word << "\": " << (dashes.evaluateString(word) ? "VALID" : "INVALID")
+             << (compiledDashes.evaluateString(word) == dashes.evaluateString(word) ? "" : " (dense DFA disagrees)") << endl;
+
+    // every construction has to accept the same words, the NFAs through their own lambda closures
+    for (string pattern : {"(ab)*", "(a|b)*c", "a*b*", "a(b|c)+d?"})
+    {
+        Regex regex(pattern);
+        NFA thompson = regex.toThompsonNFA(), glushkov = regex.toGlushkovNFA();
+        DFA deterministic = regex.toDFA();
+        cout << "Regex " << pattern << ":";
+        for (string word : {"", "ab", "abab", "ababab", "abc", "aab", "abcd", "ba"})
+        {
+            bool accepted = deterministic.evaluateString(word);
+            cout << " \"" << word << "\" " << (accepted ? "VALID" : "INVALID");
+            if (thompson.evaluateString(word) != accepted || glushkov.evaluateString(word) != accepted)
+                cout << " (NFAs disagree)";
+        }
+        cout << endl;
+    }
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,254 @@
+#pragma once
+
+#include <map>
+#include <mutex>
+#include <queue>
+#include <string>
+#include <thread>
+#include <vector>
+#include <ostream>
+#include <optional>
+#include <functional>
+#include <string_view>
+#include <condition_variable>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#else
+#include <fstream>
+#include <sstream>
+#endif
+
+using namespace std;
+
+namespace fa
+{
+    // blocking queue with a fixed capacity, push waits while full and pop waits while empty
+    template <typename ValueType>
+    class BoundedQueue
+    {
+    private:
+        queue<ValueType> values;
+        size_t capacity;
+        bool closed = false;
+        mutex queueMutex;
+        condition_variable notFull, notEmpty;
+
+    public:
+        explicit BoundedQueue(size_t capacity) : capacity(capacity) {}
+
+        void push(ValueType value)
+        {
+            unique_lock<mutex> lock(queueMutex);
+            notFull.wait(lock, [this]
+                         { return values.size() < capacity || closed; });
+            if (closed)
+                return;
+            values.push(move(value));
+            notEmpty.notify_one();
+        }
+        // empty once the queue is closed and drained
+        optional<ValueType> pop()
+        {
+            unique_lock<mutex> lock(queueMutex);
+            notEmpty.wait(lock, [this]
+                          { return !values.empty() || closed; });
+            if (values.empty())
+                return nullopt;
+            ValueType value = move(values.front());
+            values.pop();
+            notFull.notify_one();
+            return value;
+        }
+        void close()
+        {
+            lock_guard<mutex> lock(queueMutex);
+            closed = true;
+            notFull.notify_all();
+            notEmpty.notify_all();
+        }
+    };
+
+    // read only view of a whole file, memory mapped where possible
+    class MappedFile
+    {
+    private:
+        const char *data = nullptr;
+        size_t size = 0;
+#ifndef _WIN32
+        int descriptor = -1;
+#else
+        string contents;
+#endif
+
+    public:
+        explicit MappedFile(const string &path)
+        {
+#ifndef _WIN32
+            descriptor = open(path.c_str(), O_RDONLY);
+            if (descriptor < 0)
+                throw(runtime_error("Could not open " + path + "."));
+            // the destructor does not run when the constructor throws, so the descriptor is closed here
+            struct stat fileStat;
+            if (fstat(descriptor, &fileStat) < 0)
+            {
+                close(descriptor);
+                throw(runtime_error("Could not stat " + path + "."));
+            }
+            size = fileStat.st_size;
+            if (size > 0)
+            {
+                void *mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+                if (mapped == MAP_FAILED)
+                {
+                    close(descriptor);
+                    throw(runtime_error("Could not map " + path + "."));
+                }
+                madvise(mapped, size, MADV_SEQUENTIAL);
+                data = (const char *)mapped;
+            }
+#else
+            ifstream in(path, ios::binary);
+            if (!in)
+                throw(runtime_error("Could not open " + path + "."));
+            stringstream buffer;
+            buffer << in.rdbuf();
+            contents = buffer.str();
+            data = contents.data();
+            size = contents.size();
+#endif
+        }
+        ~MappedFile()
+        {
+#ifndef _WIN32
+            if (data != nullptr)
+                munmap((void *)data, size);
+            if (descriptor >= 0)
+                close(descriptor);
+#endif
+        }
+        MappedFile(const MappedFile &) = delete;
+        MappedFile &operator=(const MappedFile &) = delete;
+
+        string_view getContents() const { return string_view(data, size); }
+    };
+
+    // reader -> evaluators -> ordered writer, connected by bounded queues
+    // words are views into the mapped input, every chunk of words comes back as one block of output text
+    class WordPipeline
+    {
+    public:
+        typedef function<void(string_view, string &)> Evaluator;
+        typedef function<void(const vector<string_view> &, string &)> ChunkEvaluator;
+
+    private:
+        size_t chunkSize;
+        unsigned threadCount;
+        size_t queueCapacity;
+
+    public:
+        WordPipeline(unsigned threadCount, size_t chunkSize = 4096, size_t queueCapacity = 64)
+            : chunkSize(chunkSize), threadCount(max(threadCount, 1u)), queueCapacity(queueCapacity) {}
+
+        // the evaluator appends the answer for one word to the output of its chunk
+        void run(string_view text, ostream &out, Evaluator evaluator) const
+        {
+            run(text, out, ChunkEvaluator([&evaluator](const vector<string_view> &words, string &output)
+                                          {
+                                              for (auto word : words)
+                                                  evaluator(word, output);
+                                          }));
+        }
+
+        void run(string_view text, ostream &out, ChunkEvaluator evaluator) const
+        {
+            BoundedQueue<pair<size_t, vector<string_view>>> inputQueue(queueCapacity);
+            BoundedQueue<pair<size_t, string>> outputQueue(queueCapacity);
+
+            // the reader hands out a chunk only while it is less than queueCapacity chunks ahead of the writer,
+            // so one slow chunk cannot make the writer hold an unbounded number of finished ones
+            mutex windowMutex;
+            condition_variable windowMoved;
+            size_t written = 0;
+            auto handOut = [&](size_t sequence, vector<string_view> chunk)
+            {
+                {
+                    unique_lock<mutex> lock(windowMutex);
+                    windowMoved.wait(lock, [&]
+                                     { return sequence < written + queueCapacity; });
+                }
+                inputQueue.push(make_pair(sequence, move(chunk)));
+            };
+
+            // reader, splits on whitespace without copying
+            thread reader([&]
+                          {
+                              size_t sequence = 0, position = 0;
+                              vector<string_view> chunk;
+                              chunk.reserve(chunkSize);
+                              while (position < text.size())
+                              {
+                                  while (position < text.size() && isspace((unsigned char)text[position]))
+                                      position++;
+                                  size_t start = position;
+                                  while (position < text.size() && !isspace((unsigned char)text[position]))
+                                      position++;
+                                  if (position > start)
+                                      chunk.push_back(text.substr(start, position - start));
+                                  if (chunk.size() == chunkSize)
+                                  {
+                                      handOut(sequence++, move(chunk));
+                                      chunk = vector<string_view>();
+                                      chunk.reserve(chunkSize);
+                                  }
+                              }
+                              if (!chunk.empty())
+                                  handOut(sequence++, move(chunk));
+                              inputQueue.close();
+                          });
+
+            vector<thread> evaluators;
+            for (unsigned index = 0; index < threadCount; index++)
+                evaluators.emplace_back([&]
+                                        {
+                                            while (auto chunk = inputQueue.pop())
+                                            {
+                                                string output;
+                                                evaluator(chunk->second, output);
+                                                outputQueue.push(make_pair(chunk->first, move(output)));
+                                            }
+                                        });
+
+            // writer, puts chunks back in input order and writes them in large blocks
+            thread writer([&]
+                          {
+                              map<size_t, string> pending;
+                              size_t nextSequence = 0;
+                              while (auto block = outputQueue.pop())
+                              {
+                                  pending.insert(move(*block));
+                                  for (auto itp = pending.begin(); itp != pending.end() && itp->first == nextSequence; itp = pending.erase(itp))
+                                  {
+                                      out.write(itp->second.data(), itp->second.size());
+                                      nextSequence++;
+                                  }
+                                  {
+                                      lock_guard<mutex> lock(windowMutex);
+                                      written = nextSequence;
+                                  }
+                                  windowMoved.notify_one();
+                              }
+                              out.flush();
+                          });
+
+            reader.join();
+            for (auto &evaluatorThread : evaluators)
+                evaluatorThread.join();
+            outputQueue.close();
+            writer.join();
+        }
+    };
+};
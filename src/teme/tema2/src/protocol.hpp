@@ -0,0 +1,330 @@
+#pragma once
+
+#include <cerrno>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <stdexcept>
+#include <string_view>
+
+#include <poll.h>
+#include <unistd.h>
+#include <sys/un.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+
+using namespace std;
+
+namespace fa
+{
+    // binary protocol of the query server, both ends run on the same machine so integers travel in
+    // native byte order. every frame is a uint32 payload length followed by the payload:
+    //   request:  opcode u8, request id u32, name length u16, name, word count u32, (length u32, bytes) per word
+    //   response: request id u32, status u8, count u32, then per opcode
+    //             Evaluate / Parse / Pushdown: one byte per word, 1 when accepted
+    //             Paths: (length u32, int32 states) per word, an empty path when rejected, the states are the
+    //                    ones of the loaded automata, not merged by minimization
+    //             List: (length u32, bytes) per name
+    // requests may be pipelined, responses come back in request order, a frame over FrameSocket::maximumFrameSize
+    // closes the connection
+    enum class Opcode : uint8_t
+    {
+        Evaluate = 1,
+        Paths = 2,
+        Parse = 3,
+        Pushdown = 4,
+        // words are the kind (dfa, nfa, cnf or pda) and the file to load under the name, a plain file
+        // name inside the directory the server was started with
+        Load = 5,
+        List = 6
+    };
+
+    enum class Status : uint8_t
+    {
+        Ok = 0,
+        UnknownAutomata = 1,
+        BadRequest = 2,
+        LoadFailed = 3,
+        // the server was started without a load directory or the file is outside of it
+        Forbidden = 4
+    };
+
+    struct Request
+    {
+        Opcode opcode;
+        uint32_t requestId;
+        string_view name;
+        vector<string_view> words;
+    };
+
+    struct Response
+    {
+        uint32_t requestId;
+        Status status;
+        uint32_t count;
+        string_view body;
+    };
+
+    template <typename ValueType>
+    void appendValue(string &out, ValueType value)
+    {
+        out.append(reinterpret_cast<const char *>(&value), sizeof(value));
+    }
+
+    // reads fixed size values from a frame, running past its end throws
+    class FrameReader
+    {
+    private:
+        string_view frame;
+        size_t position = 0;
+
+    public:
+        explicit FrameReader(string_view frame) : frame(frame) {}
+
+        template <typename ValueType>
+        ValueType read()
+        {
+            if (position + sizeof(ValueType) > frame.size())
+                throw(runtime_error("Truncated frame."));
+            ValueType value;
+            memcpy(&value, frame.data() + position, sizeof(value));
+            position += sizeof(value);
+            return value;
+        }
+        string_view readBytes(size_t size)
+        {
+            if (position + size > frame.size())
+                throw(runtime_error("Truncated frame."));
+            string_view bytes = frame.substr(position, size);
+            position += size;
+            return bytes;
+        }
+        string_view rest() const { return frame.substr(position); }
+    };
+
+    inline void encodeRequest(string &out, Opcode opcode, uint32_t requestId, string_view name, const vector<string_view> &words)
+    {
+        size_t lengthPosition = out.size();
+        appendValue<uint32_t>(out, 0);
+        appendValue<uint8_t>(out, (uint8_t)opcode);
+        appendValue<uint32_t>(out, requestId);
+        appendValue<uint16_t>(out, name.size());
+        out.append(name);
+        appendValue<uint32_t>(out, words.size());
+        for (auto word : words)
+        {
+            appendValue<uint32_t>(out, word.size());
+            out.append(word);
+        }
+        uint32_t length = out.size() - lengthPosition - sizeof(uint32_t);
+        memcpy(&out[lengthPosition], &length, sizeof(length));
+    }
+
+    // the words point into the frame, which has to outlive the request
+    inline Request decodeRequest(string_view frame)
+    {
+        FrameReader reader(frame);
+        Request request;
+        request.opcode = (Opcode)reader.read<uint8_t>();
+        request.requestId = reader.read<uint32_t>();
+        request.name = reader.readBytes(reader.read<uint16_t>());
+        uint32_t wordCount = reader.read<uint32_t>();
+        // every word takes at least its length prefix, so the count the peer sent cannot reserve more than that
+        request.words.reserve(min<size_t>(wordCount, reader.rest().size() / sizeof(uint32_t)));
+        for (uint32_t index = 0; index < wordCount; index++)
+            request.words.push_back(reader.readBytes(reader.read<uint32_t>()));
+        return request;
+    }
+
+    // writes the header, the caller appends the body and closes the frame with finishResponse
+    inline size_t beginResponse(string &out, uint32_t requestId, Status status, uint32_t count)
+    {
+        size_t lengthPosition = out.size();
+        appendValue<uint32_t>(out, 0);
+        appendValue<uint32_t>(out, requestId);
+        appendValue<uint8_t>(out, (uint8_t)status);
+        appendValue<uint32_t>(out, count);
+        return lengthPosition;
+    }
+    inline void finishResponse(string &out, size_t lengthPosition)
+    {
+        uint32_t length = out.size() - lengthPosition - sizeof(uint32_t);
+        memcpy(&out[lengthPosition], &length, sizeof(length));
+    }
+
+    inline Response decodeResponse(string_view frame)
+    {
+        FrameReader reader(frame);
+        Response response;
+        response.requestId = reader.read<uint32_t>();
+        response.status = (Status)reader.read<uint8_t>();
+        response.count = reader.read<uint32_t>();
+        response.body = reader.rest();
+        return response;
+    }
+
+    // buffered frame I/O over a connected socket, every read pulls in as much as the kernel has
+    // so a burst of pipelined frames is parsed out of one buffer
+    class FrameSocket
+    {
+    private:
+        int descriptor;
+        string input;
+        size_t consumed = 0;
+        bool oversized = false;
+
+    public:
+        // bytes pulled in by one read, also the most a server batches up before it writes
+        static constexpr size_t bufferSize = 65536;
+        // a longer frame is treated as a broken peer and the connection is dropped instead of buffering it
+        static constexpr uint32_t maximumFrameSize = 64 << 20;
+
+        explicit FrameSocket(int descriptor) : descriptor(descriptor) {}
+        FrameSocket(const FrameSocket &) = delete;
+        FrameSocket &operator=(const FrameSocket &) = delete;
+        ~FrameSocket() { close(descriptor); }
+
+        // a complete frame already in the buffer, without touching the socket
+        bool nextBufferedFrame(string_view &frame)
+        {
+            if (input.size() - consumed < sizeof(uint32_t))
+                return false;
+            uint32_t length;
+            memcpy(&length, input.data() + consumed, sizeof(length));
+            if (length > maximumFrameSize)
+            {
+                oversized = true;
+                return false;
+            }
+            if (input.size() - consumed - sizeof(uint32_t) < length)
+                return false;
+            frame = string_view(input).substr(consumed + sizeof(uint32_t), length);
+            consumed += sizeof(uint32_t) + length;
+            return true;
+        }
+
+        // blocks until more bytes arrive, false once the peer closed the connection or announced a frame
+        // over maximumFrameSize, frames returned earlier are invalidated
+        bool fill()
+        {
+            if (oversized)
+                return false;
+            input.erase(0, consumed);
+            consumed = 0;
+            size_t size = input.size();
+            input.resize(size + bufferSize);
+            ssize_t received;
+            do
+                received = read(descriptor, &input[size], bufferSize);
+            while (received < 0 && errno == EINTR);
+            input.resize(size + max<ssize_t>(received, 0));
+            return received > 0;
+        }
+
+        bool writeAll(const string &out)
+        {
+            size_t written = 0;
+            while (written < out.size())
+            {
+                ssize_t sent = write(descriptor, out.data() + written, out.size() - written);
+                if (sent < 0 && errno == EINTR)
+                    continue;
+                if (sent <= 0)
+                    return false;
+                written += sent;
+            }
+            return true;
+        }
+
+        // writes everything while still buffering whatever the peer sends meanwhile, so a client that
+        // pipelines more than the socket holds cannot block on a server that blocks writing the answers.
+        // frames returned earlier are invalidated
+        bool writeAllWhileReading(const string &out)
+        {
+            size_t written = 0;
+            while (written < out.size())
+            {
+                pollfd events{descriptor, POLLIN | POLLOUT, 0};
+                if (poll(&events, 1, -1) < 0)
+                {
+                    if (errno == EINTR)
+                        continue;
+                    return false;
+                }
+                if ((events.revents & POLLIN) && !fill())
+                    return false;
+                if (events.revents & POLLOUT)
+                {
+                    ssize_t sent = send(descriptor, out.data() + written, out.size() - written, MSG_DONTWAIT | MSG_NOSIGNAL);
+                    if (sent < 0 && (errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK))
+                        continue;
+                    if (sent <= 0)
+                        return false;
+                    written += sent;
+                }
+                else if (events.revents & (POLLERR | POLLHUP | POLLNVAL))
+                    return false;
+            }
+            return true;
+        }
+    };
+
+    inline sockaddr_un socketAddress(const string &path)
+    {
+        sockaddr_un address{};
+        address.sun_family = AF_UNIX;
+        if (path.size() >= sizeof(address.sun_path))
+            throw(runtime_error("Socket path is too long."));
+        strcpy(address.sun_path, path.c_str());
+        return address;
+    }
+
+    inline int listenOn(const string &path)
+    {
+        sockaddr_un address = socketAddress(path);
+        // only a stale socket left behind by an earlier server is replaced, never a regular file and never
+        // the socket of a server that still accepts connections
+        struct stat status;
+        if (lstat(path.c_str(), &status) == 0)
+        {
+            if (!S_ISSOCK(status.st_mode))
+                throw(runtime_error(path + " exists and is not a socket."));
+            int probe = socket(AF_UNIX, SOCK_STREAM, 0);
+            if (probe < 0)
+                throw(runtime_error("Could not create socket."));
+            int connected = connect(probe, (sockaddr *)&address, sizeof(address));
+            int connectError = errno;
+            close(probe);
+            if (connected == 0)
+                throw(runtime_error("Another server is listening on " + path + "."));
+            if (connectError != ECONNREFUSED)
+                throw(runtime_error("Could not check the socket at " + path + "."));
+            unlink(path.c_str());
+        }
+        int descriptor = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (descriptor < 0)
+            throw(runtime_error("Could not create socket."));
+        if (bind(descriptor, (sockaddr *)&address, sizeof(address)) < 0 || listen(descriptor, 128) < 0)
+        {
+            close(descriptor);
+            throw(runtime_error("Could not listen on " + path + "."));
+        }
+        return descriptor;
+    }
+
+    inline int connectTo(const string &path)
+    {
+        sockaddr_un address = socketAddress(path);
+        int descriptor = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (descriptor < 0)
+            throw(runtime_error("Could not create socket."));
+        if (connect(descriptor, (sockaddr *)&address, sizeof(address)) < 0)
+        {
+            close(descriptor);
+            throw(runtime_error("Could not connect to " + path + "."));
+        }
+        return descriptor;
+    }
+};
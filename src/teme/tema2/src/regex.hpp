@@ -0,0 +1,430 @@
+#pragma once
+
+#include <set>
+#include <string>
+#include <vector>
+#include <stdexcept>
+#include "fa.hpp"
+
+using namespace std;
+
+namespace fa
+{
+    // regular expressions over bytes: literals, ., [a-z], [^...], \\ escapes, grouping, |, *, + and ?, . and [^...] include the NUL byte
+    class Regex
+    {
+    private:
+        enum class NodeType
+        {
+            Empty,
+            Symbols,
+            Concatenation,
+            Alternation,
+            Star,
+            Plus,
+            Optional
+        };
+        struct Node
+        {
+            NodeType type;
+            set<char> symbols;
+            int left = -1, right = -1;
+        };
+
+        string pattern;
+        size_t position = 0;
+        vector<Node> nodes;
+        int root = -1;
+
+        int addNode(NodeType type, int left = -1, int right = -1, set<char> symbols = set<char>())
+        {
+            nodes.push_back(Node{type, move(symbols), left, right});
+            return nodes.size() - 1;
+        }
+
+        bool atEnd() const { return position == pattern.size(); }
+        char peek() const { return pattern[position]; }
+
+        char parseEscape()
+        {
+            if (atEnd())
+                throw(runtime_error("Regex ends with an escape."));
+            char character = pattern[position++];
+            switch (character)
+            {
+            case 'n':
+                return '\n';
+            case 't':
+                return '\t';
+            case 'r':
+                return '\r';
+            default:
+                return character;
+            }
+        }
+
+        set<char> parseClass()
+        {
+            // the opening [ is already consumed
+            bool negated = !atEnd() && peek() == '^';
+            if (negated)
+                position++;
+
+            set<char> symbols;
+            bool first = true;
+            while (!atEnd() && (peek() != ']' || first))
+            {
+                first = false;
+                char low = pattern[position++];
+                if (low == '\\')
+                    low = parseEscape();
+                char high = low;
+                if (position + 1 < pattern.size() && peek() == '-' && pattern[position + 1] != ']')
+                {
+                    position++;
+                    high = pattern[position++];
+                    if (high == '\\')
+                        high = parseEscape();
+                }
+                if ((unsigned char)low > (unsigned char)high)
+                    throw(runtime_error("Invalid range in character class."));
+                for (int character = (unsigned char)low; character <= (unsigned char)high; character++)
+                    symbols.insert((char)character);
+            }
+            if (atEnd())
+                throw(runtime_error("Unterminated character class."));
+            position++;
+
+            if (!negated)
+                return symbols;
+            set<char> complement;
+            for (int character = 0; character < 256; character++)
+                if (symbols.find((char)character) == symbols.end())
+                    complement.insert((char)character);
+            return complement;
+        }
+
+        int parseAtom()
+        {
+            char character = pattern[position++];
+            switch (character)
+            {
+            case '(':
+            {
+                int inner = parseAlternation();
+                if (atEnd() || peek() != ')')
+                    throw(runtime_error("Unbalanced parentheses in regex."));
+                position++;
+                return inner;
+            }
+            case '[':
+                return addNode(NodeType::Symbols, -1, -1, parseClass());
+            case '.':
+            {
+                set<char> symbols;
+                for (int any = 0; any < 256; any++)
+                    if (any != '\n')
+                        symbols.insert((char)any);
+                return addNode(NodeType::Symbols, -1, -1, symbols);
+            }
+            case '\\':
+                return addNode(NodeType::Symbols, -1, -1, set<char>{parseEscape()});
+            case '*':
+            case '+':
+            case '?':
+                throw(runtime_error("Nothing to repeat in regex."));
+            default:
+                return addNode(NodeType::Symbols, -1, -1, set<char>{character});
+            }
+        }
+
+        int parseRepetition()
+        {
+            int node = parseAtom();
+            while (!atEnd() && (peek() == '*' || peek() == '+' || peek() == '?'))
+            {
+                char operation = pattern[position++];
+                node = addNode(operation == '*' ? NodeType::Star : (operation == '+' ? NodeType::Plus : NodeType::Optional), node);
+            }
+            return node;
+        }
+
+        int parseConcatenation()
+        {
+            int node = -1;
+            while (!atEnd() && peek() != '|' && peek() != ')')
+            {
+                int next = parseRepetition();
+                node = (node == -1) ? next : addNode(NodeType::Concatenation, node, next);
+            }
+            return (node == -1) ? addNode(NodeType::Empty) : node;
+        }
+
+        int parseAlternation()
+        {
+            int node = parseConcatenation();
+            while (!atEnd() && peek() == '|')
+            {
+                position++;
+                node = addNode(NodeType::Alternation, node, parseConcatenation());
+            }
+            return node;
+        }
+
+        // Thompson fragment, returns (start, end) with a single end state
+        pair<int, int> buildThompson(int node, NFA &nfa, int &stateCount) const
+        {
+            auto newState = [&nfa, &stateCount]()
+            {
+                nfa.addState(stateCount);
+                return stateCount++;
+            };
+            char lambda = nfa.getLambdaCharacter();
+            const Node &current = nodes[node];
+
+            switch (current.type)
+            {
+            case NodeType::Empty:
+            {
+                int start = newState(), end = newState();
+                nfa.addTransition(start, end, lambda);
+                return make_pair(start, end);
+            }
+            case NodeType::Symbols:
+            {
+                int start = newState(), end = newState();
+                for (auto character : current.symbols)
+                    if (character != lambda)
+                        nfa.addTransition(start, end, character);
+                return make_pair(start, end);
+            }
+            case NodeType::Concatenation:
+            {
+                auto left = buildThompson(current.left, nfa, stateCount);
+                auto right = buildThompson(current.right, nfa, stateCount);
+                nfa.addTransition(left.second, right.first, lambda);
+                return make_pair(left.first, right.second);
+            }
+            case NodeType::Alternation:
+            {
+                int start = newState();
+                auto left = buildThompson(current.left, nfa, stateCount);
+                auto right = buildThompson(current.right, nfa, stateCount);
+                int end = newState();
+                nfa.addTransition(start, left.first, lambda);
+                nfa.addTransition(start, right.first, lambda);
+                nfa.addTransition(left.second, end, lambda);
+                nfa.addTransition(right.second, end, lambda);
+                return make_pair(start, end);
+            }
+            default:
+            {
+                // star, plus and optional only differ in the skip and loop edges
+                int start = newState();
+                auto inner = buildThompson(current.left, nfa, stateCount);
+                int end = newState();
+                nfa.addTransition(start, inner.first, lambda);
+                nfa.addTransition(inner.second, end, lambda);
+                if (current.type != NodeType::Plus)
+                    nfa.addTransition(start, end, lambda);
+                if (current.type != NodeType::Optional)
+                    nfa.addTransition(inner.second, inner.first, lambda);
+                return make_pair(start, end);
+            }
+            }
+        }
+
+        // nullable, first and last position sets of every node, follow sets of every position
+        void buildGlushkov(int node, vector<int> &positionOf, vector<bool> &nullable, vector<set<int>> &first,
+                           vector<set<int>> &last, vector<set<int>> &follow) const
+        {
+            const Node &current = nodes[node];
+            if (current.left != -1)
+                buildGlushkov(current.left, positionOf, nullable, first, last, follow);
+            if (current.right != -1)
+                buildGlushkov(current.right, positionOf, nullable, first, last, follow);
+
+            switch (current.type)
+            {
+            case NodeType::Empty:
+                nullable[node] = true;
+                break;
+            case NodeType::Symbols:
+                positionOf[node] = follow.size();
+                follow.emplace_back();
+                nullable[node] = false;
+                first[node] = last[node] = set<int>{positionOf[node]};
+                break;
+            case NodeType::Concatenation:
+                nullable[node] = nullable[current.left] && nullable[current.right];
+                first[node] = first[current.left];
+                if (nullable[current.left])
+                    first[node].insert(first[current.right].begin(), first[current.right].end());
+                last[node] = last[current.right];
+                if (nullable[current.right])
+                    last[node].insert(last[current.left].begin(), last[current.left].end());
+                for (auto position : last[current.left])
+                    follow[position].insert(first[current.right].begin(), first[current.right].end());
+                break;
+            case NodeType::Alternation:
+                nullable[node] = nullable[current.left] || nullable[current.right];
+                first[node] = first[current.left];
+                first[node].insert(first[current.right].begin(), first[current.right].end());
+                last[node] = last[current.left];
+                last[node].insert(last[current.right].begin(), last[current.right].end());
+                break;
+            default:
+                nullable[node] = (current.type != NodeType::Plus) || nullable[current.left];
+                first[node] = first[current.left];
+                last[node] = last[current.left];
+                if (current.type != NodeType::Optional)
+                    for (auto position : last[current.left])
+                        follow[position].insert(first[current.left].begin(), first[current.left].end());
+                break;
+            }
+        }
+
+        // first, last and follow sets of the symbol occurrences, symbols[p] are the bytes position p reads
+        struct Positions
+        {
+            set<int> first, last;
+            vector<set<int>> follow;
+            vector<const set<char> *> symbols;
+            bool nullable;
+        };
+
+        Positions getPositions() const
+        {
+            vector<int> positionOf(nodes.size(), -1);
+            vector<bool> nullable(nodes.size(), false);
+            vector<set<int>> first(nodes.size()), last(nodes.size());
+            Positions positions;
+            buildGlushkov(root, positionOf, nullable, first, last, positions.follow);
+
+            positions.symbols.resize(positions.follow.size());
+            for (size_t node = 0; node < nodes.size(); node++)
+                if (positionOf[node] != -1)
+                    positions.symbols[positionOf[node]] = &nodes[node].symbols;
+            positions.first = first[root];
+            positions.last = last[root];
+            positions.nullable = nullable[root];
+            return positions;
+        }
+
+        bool findUnusedCharacter(char &unused) const
+        {
+            vector<bool> used(256, false);
+            for (const auto &node : nodes)
+                for (auto character : node.symbols)
+                    used[(unsigned char)character] = true;
+            for (int character = 0; character < 256; character++)
+                if (!used[character])
+                {
+                    unused = (char)character;
+                    return true;
+                }
+            return false;
+        }
+
+        // subset construction over the positions, state 0 of a subset stands for the initial state
+        DFA determinizePositions() const
+        {
+            Positions positions = getPositions();
+            DFA dfa;
+            dfa.setLambdaString(vector<char>());
+
+            map<set<int>, int> subsetEncoding{{set<int>{0}, 0}};
+            vector<set<int>> subsets{set<int>{0}};
+            dfa.addState(0);
+            dfa.setInitialState(0);
+            for (size_t current = 0; current < subsets.size(); current++)
+            {
+                map<char, set<int>> next;
+                for (auto state : subsets[current])
+                    for (auto position : (state == 0) ? positions.first : positions.follow[state - 1])
+                        for (auto character : *positions.symbols[position])
+                            next[character].insert(position + 1);
+                for (const auto &edge : next)
+                {
+                    auto its = subsetEncoding.find(edge.second);
+                    if (its == subsetEncoding.end())
+                    {
+                        its = subsetEncoding.insert(make_pair(edge.second, (int)subsets.size())).first;
+                        subsets.push_back(edge.second);
+                        dfa.addState(its->second);
+                    }
+                    dfa.addTransition(current, its->second, edge.first);
+                }
+            }
+            for (size_t current = 0; current < subsets.size(); current++)
+                for (auto state : subsets[current])
+                    if ((state == 0 && positions.nullable) || (state != 0 && positions.last.count(state - 1)))
+                        dfa.addFinalState(current);
+            return dfa;
+        }
+
+    public:
+        explicit Regex(const string &pattern) : pattern(pattern)
+        {
+            root = parseAlternation();
+            if (!atEnd())
+                throw(runtime_error("Unbalanced parentheses in regex."));
+        }
+
+        // Thompson construction, lambda transitions use the given character. it cannot also be read, so it is
+        // left out of classes such as . and [^...] and a pattern that names it on its own is rejected
+        NFA toThompsonNFA(char lambdaCharacter = '\0') const
+        {
+            for (const auto &node : nodes)
+                if (node.symbols.size() == 1 && *node.symbols.begin() == lambdaCharacter)
+                    throw(runtime_error("Regex uses the lambda character."));
+
+            NFA nfa(0, lambdaCharacter, "");
+            int stateCount = 0;
+            auto fragment = buildThompson(root, nfa, stateCount);
+            nfa.setInitialState(fragment.first);
+            nfa.addFinalState(fragment.second);
+            return nfa;
+        }
+
+        // position automaton, lambda free with one state per symbol occurrence plus the initial state 0.
+        // it has no lambda edges but an NFA still needs a lambda character, so the first byte the pattern
+        // does not use is taken, a pattern that uses every byte cannot be turned into a Glushkov NFA
+        NFA toGlushkovNFA() const
+        {
+            char lambdaCharacter;
+            if (!findUnusedCharacter(lambdaCharacter))
+                throw(runtime_error("Regex uses every byte, none is left for the lambda character."));
+
+            Positions positions = getPositions();
+            NFA nfa(0, lambdaCharacter, "");
+            for (size_t state = 0; state <= positions.follow.size(); state++)
+                nfa.addState(state);
+            nfa.setInitialState(0);
+            for (auto position : positions.first)
+                for (auto character : *positions.symbols[position])
+                    nfa.addTransition(0, position + 1, character);
+            for (size_t position = 0; position < positions.follow.size(); position++)
+                for (auto next : positions.follow[position])
+                    for (auto character : *positions.symbols[next])
+                        nfa.addTransition(position + 1, next + 1, character);
+            for (auto position : positions.last)
+                nfa.addFinalState(position + 1);
+            if (positions.nullable)
+                nfa.addFinalState(0);
+            return nfa;
+        }
+
+        // regex -> Glushkov NFA -> reduction -> subset construction -> minimization, a pattern that uses
+        // every byte is determinized straight from its positions instead
+        DFA toDFA() const
+        {
+            char lambdaCharacter;
+            DFA dfa = findUnusedCharacter(lambdaCharacter) ? toGlushkovNFA().reduce().turnDeterministic() : determinizePositions();
+            dfa.minimize();
+            return dfa;
+        }
+
+        const string &getPattern() const { return pattern; }
+    };
+};
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <map>
+#include <mutex>
+#include <memory>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <stdexcept>
+#include "fa.hpp"
+
+using namespace std;
+
+namespace fa
+{
+    // named, immutable automata shared between threads
+    // readers grab the current snapshot with atomic_load, writers build a new one and swap it in,
+    // so nobody ever sees a half built automaton. atomic_load / atomic_store on a shared_ptr are not
+    // lock free in libstdc++, they take a mutex from a global pool for the few instructions of the
+    // pointer copy, so a reader can wait behind a concurrent swap but never behind loading or compiling
+    template <typename AutomataType>
+    class Registry
+    {
+    private:
+        typedef map<string, shared_ptr<const AutomataType>> SnapshotMap;
+
+        // only ever accessed through atomic_load / atomic_store
+        shared_ptr<const SnapshotMap> snapshots = make_shared<const SnapshotMap>();
+        // serializes writers only, readers never touch it, the slow part of a reload runs before it is taken
+        mutex writerMutex;
+
+        void update(const string &name, shared_ptr<const AutomataType> automata)
+        {
+            lock_guard<mutex> lock(writerMutex);
+            auto updated = make_shared<SnapshotMap>(*atomic_load(&snapshots));
+            if (automata)
+                (*updated)[name] = automata;
+            else
+                updated->erase(name);
+            atomic_store(&snapshots, shared_ptr<const SnapshotMap>(updated));
+        }
+
+    public:
+        Registry() = default;
+        Registry(const Registry &) = delete;
+        Registry &operator=(const Registry &) = delete;
+
+        // the returned snapshot stays valid for as long as the caller holds it, even across reloads
+        shared_ptr<const AutomataType> get(const string &name) const
+        {
+            auto current = atomic_load(&snapshots);
+            auto its = current->find(name);
+            return (its != current->end()) ? its->second : nullptr;
+        }
+
+        void publish(const string &name, shared_ptr<const AutomataType> automata)
+        {
+            if (!automata)
+                throw(invalid_argument("Cannot publish an empty automata."));
+            update(name, automata);
+        }
+        void publish(const string &name, AutomataType automata)
+        {
+            update(name, make_shared<const AutomataType>(move(automata)));
+        }
+
+        // the loader runs outside of any lock, a failing loader leaves the previous version in place
+        template <typename Loader>
+        void reload(const string &name, Loader loader)
+        {
+            shared_ptr<const AutomataType> automata = loader();
+            publish(name, automata);
+        }
+
+        void remove(const string &name) { update(name, nullptr); }
+
+        vector<string> getNames() const
+        {
+            vector<string> names;
+            auto current = atomic_load(&snapshots);
+            for (auto its = current->begin(); its != current->end(); its++)
+                names.push_back(its->first);
+            return names;
+        }
+    };
+
+    // reads a DFA file, minimizes and compiles it into an immutable snapshot
+    inline shared_ptr<const DenseDFA> loadDenseDFA(const string &path)
+    {
+        ifstream in(path);
+        if (!in)
+            throw(runtime_error("Could not open " + path + "."));
+        DFA dfa;
+        in >> dfa;
+        dfa.minimize();
+        return make_shared<const DenseDFA>(dfa);
+    }
+};
@@ -0,0 +1,63 @@
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include "fa.hpp"
+#include "regex.hpp"
+
+using namespace std;
+using namespace fa;
+
+// usage: scan <dfa file> <text file> [longest|overlapping|ends]
+//        scan -e <regex> <text file> [longest|overlapping|ends]
+int main(int argc, char *argv[])
+{
+    bool fromRegex = (argc > 1 && string(argv[1]) == "-e");
+    int argumentOffset = fromRegex ? 1 : 0;
+    if (argc < 3 + argumentOffset)
+    {
+        cerr << "Usage: " << argv[0] << " <dfa file> <text file> [longest|overlapping|ends]" << endl;
+        cerr << "       " << argv[0] << " -e <regex> <text file> [longest|overlapping|ends]" << endl;
+        return 1;
+    }
+    string mode = (argc > 3 + argumentOffset) ? argv[3 + argumentOffset] : "longest";
+
+    ifstream tin(argv[2 + argumentOffset], ios::binary);
+    if (!tin)
+    {
+        cerr << "Could not open " << argv[2 + argumentOffset] << endl;
+        return 1;
+    }
+
+    DFA dfa;
+    if (fromRegex)
+        dfa = Regex(argv[2]).toDFA();
+    else
+    {
+        ifstream din(argv[1]);
+        if (!din)
+        {
+            cerr << "Could not open " << argv[1] << endl;
+            return 1;
+        }
+        din >> dfa;
+        dfa.minimize();
+    }
+    Scanner scanner(dfa);
+
+    stringstream buffer;
+    buffer << tin.rdbuf();
+    string text = buffer.str();
+
+    if (mode == "ends")
+    {
+        for (auto end : scanner.findMatchEnds(text))
+            cout << end << '\n';
+    }
+    else
+    {
+        auto semantics = (mode == "overlapping") ? MatchSemantics::AllOverlapping : MatchSemantics::LeftmostLongest;
+        for (const auto &match : scanner.findAll(text, semantics))
+            cout << match.start << " " << match.end << " " << text.substr(match.start, match.end - match.start) << '\n';
+    }
+    return 0;
+}
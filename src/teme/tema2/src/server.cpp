@@ -0,0 +1,267 @@
+#include <thread>
+#include <csignal>
+#include <fstream>
+#include <iostream>
+#include "automata.hpp"
+#include "registry.hpp"
+#include "protocol.hpp"
+
+using namespace std;
+using namespace fa;
+
+// everything the server answers from, loaded once and kept compiled for the lifetime of the process
+struct Automata
+{
+    Registry<DenseDFA> finite;
+    // the same automata with only the unreachable states removed, Paths answers with the state ids of
+    // the loaded file (of the subset construction for an NFA) and minimization would merge them
+    Registry<DenseDFA> paths;
+    Registry<CNFAutomata<char>> grammars;
+    Registry<PushdownAutomata<int, char>> pushdown;
+    // Load requests may only read plain file names from here, empty when runtime loading is off
+    string loadDirectory;
+};
+
+void printUsage(const char *program)
+{
+    cerr << "Usage: " << program << " --socket <path> [--load-dir <directory>] [automata]" << endl;
+    cerr << "  --dfa <name>=<file>     DFA, compiled to a minimized dense table" << endl;
+    cerr << "  --nfa <name>=<file>     NFA, determinized and compiled to a minimized dense table" << endl;
+    cerr << "  --cnf <name>=<file>     CNF grammar evaluated with CYK" << endl;
+    cerr << "  --pda <name>=<file>     pushdown automata" << endl;
+    cerr << "With --load-dir, automata can also be loaded at runtime with a Load request naming a file in that directory." << endl;
+}
+
+template <typename AutomataType>
+AutomataType readAutomata(const string &path, AutomataType automata)
+{
+    ifstream in(path);
+    if (!in)
+        throw(runtime_error("Could not open " + path + "."));
+    in >> automata;
+    return automata;
+}
+
+void load(Automata &automata, const string &kind, const string &name, const string &path)
+{
+    if (kind == "dfa" || kind == "nfa")
+    {
+        DFA deterministic = (kind == "dfa") ? readAutomata(path, DFA()) : readAutomata(path, NFA()).reduce().turnDeterministic();
+        deterministic.removeUnreachableStates();
+        automata.paths.publish(name, DenseDFA(deterministic));
+        deterministic.minimize();
+        automata.finite.publish(name, DenseDFA(deterministic));
+    }
+    else if (kind == "cnf")
+        automata.grammars.publish(name, readAutomata(path, CNFAutomata<char>('0', 'S')));
+    else if (kind == "pda")
+        automata.pushdown.publish(name, readAutomata(path, PushdownAutomata<int, char>('0', '$')));
+    else
+        throw(runtime_error("Unknown automata kind " + kind + "."));
+}
+
+// one byte per word, 1 when the evaluator accepts it
+template <typename Evaluator>
+void answerMembership(const Request &request, string &out, Evaluator evaluator)
+{
+    size_t lengthPosition = beginResponse(out, request.requestId, Status::Ok, request.words.size());
+    for (auto word : request.words)
+        out.push_back(evaluator(word) ? 1 : 0);
+    finishResponse(out, lengthPosition);
+}
+
+void answerError(const Request &request, Status status, string &out)
+{
+    finishResponse(out, beginResponse(out, request.requestId, status, 0));
+}
+
+void answer(Automata &automata, const Request &request, string &out)
+{
+    string name(request.name);
+    switch (request.opcode)
+    {
+    case Opcode::Evaluate:
+    {
+        auto dfa = automata.finite.get(name);
+        if (!dfa)
+            return answerError(request, Status::UnknownAutomata, out);
+        return answerMembership(request, out, [&dfa](string_view word)
+                                { return dfa->evaluateString(word); });
+    }
+    case Opcode::Paths:
+    {
+        auto dfa = automata.paths.get(name);
+        if (!dfa)
+            return answerError(request, Status::UnknownAutomata, out);
+        size_t lengthPosition = beginResponse(out, request.requestId, Status::Ok, request.words.size());
+        for (auto word : request.words)
+        {
+            vector<int> path = dfa->evaluateStringWithPath(word);
+            appendValue<uint32_t>(out, path.size());
+            for (auto state : path)
+                appendValue<int32_t>(out, state);
+        }
+        return finishResponse(out, lengthPosition);
+    }
+    case Opcode::Parse:
+    {
+        auto grammar = automata.grammars.get(name);
+        if (!grammar)
+            return answerError(request, Status::UnknownAutomata, out);
+        return answerMembership(request, out, [&grammar](string_view word)
+                                { return grammar->evaluate(vector<char>(word.begin(), word.end())); });
+    }
+    case Opcode::Pushdown:
+    {
+        auto pushdown = automata.pushdown.get(name);
+        if (!pushdown)
+            return answerError(request, Status::UnknownAutomata, out);
+        return answerMembership(request, out, [&pushdown](string_view word)
+                                { return pushdown->evaluate(vector<char>(word.begin(), word.end())); });
+    }
+    case Opcode::Load:
+    {
+        if (request.words.size() != 2)
+            return answerError(request, Status::BadRequest, out);
+        string file(request.words[1]);
+        if (automata.loadDirectory.empty() || file.empty() || file == "." || file == ".." || file.find('/') != string::npos)
+            return answerError(request, Status::Forbidden, out);
+        try
+        {
+            load(automata, string(request.words[0]), name, automata.loadDirectory + "/" + file);
+        }
+        catch (const exception &)
+        {
+            return answerError(request, Status::LoadFailed, out);
+        }
+        return answerError(request, Status::Ok, out);
+    }
+    case Opcode::List:
+    {
+        vector<string> names = automata.finite.getNames();
+        for (const auto &more : {automata.grammars.getNames(), automata.pushdown.getNames()})
+            names.insert(names.end(), more.begin(), more.end());
+        size_t lengthPosition = beginResponse(out, request.requestId, Status::Ok, names.size());
+        for (const auto &automataName : names)
+        {
+            appendValue<uint32_t>(out, automataName.size());
+            out.append(automataName);
+        }
+        return finishResponse(out, lengthPosition);
+    }
+    default:
+        return answerError(request, Status::BadRequest, out);
+    }
+}
+
+// answers every frame that arrived together with a single write, so a pipelined batch of
+// requests costs one read and one write instead of one round trip each. answers are flushed
+// early once they outgrow the read buffer, which keeps a long batch from piling up in memory
+void serve(Automata &automata, int descriptor)
+{
+    FrameSocket connection(descriptor);
+    string out;
+    while (connection.fill())
+    {
+        out.clear();
+        string_view frame;
+        while (connection.nextBufferedFrame(frame))
+        {
+            Request request;
+            try
+            {
+                request = decodeRequest(frame);
+            }
+            catch (const exception &)
+            {
+                // the framing is intact, only this request is malformed
+                request.requestId = (frame.size() >= 5) ? FrameReader(frame.substr(1)).read<uint32_t>() : 0;
+                answerError(request, Status::BadRequest, out);
+                continue;
+            }
+            answer(automata, request, out);
+            if (out.size() >= FrameSocket::bufferSize)
+            {
+                if (!connection.writeAll(out))
+                    return;
+                out.clear();
+            }
+        }
+        if (!out.empty() && !connection.writeAll(out))
+            return;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    string socketPath, loadDirectory;
+    vector<pair<string, string>> initial;
+
+    for (int index = 1; index < argc; index++)
+    {
+        string argument = argv[index];
+        if (index + 1 < argc && argument == "--socket")
+            socketPath = argv[++index];
+        else if (index + 1 < argc && argument == "--load-dir")
+            loadDirectory = argv[++index];
+        else if (index + 1 < argc && (argument == "--dfa" || argument == "--nfa" || argument == "--cnf" || argument == "--pda"))
+            initial.emplace_back(argument.substr(2), argv[++index]);
+        else
+        {
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+    if (socketPath.empty())
+    {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    Automata automata;
+    automata.loadDirectory = loadDirectory;
+    try
+    {
+        for (const auto &itl : initial)
+        {
+            size_t separator = itl.second.find('=');
+            if (separator == string::npos)
+                throw(runtime_error("Expected <name>=<file> instead of " + itl.second + "."));
+            load(automata, itl.first, itl.second.substr(0, separator), itl.second.substr(separator + 1));
+        }
+    }
+    catch (const exception &exception)
+    {
+        cerr << exception.what() << endl;
+        return 1;
+    }
+
+    // a client hanging up mid write must not take the server down
+    signal(SIGPIPE, SIG_IGN);
+    int listener;
+    try
+    {
+        listener = listenOn(socketPath);
+    }
+    catch (const exception &exception)
+    {
+        cerr << exception.what() << endl;
+        return 1;
+    }
+    cerr << "Listening on " << socketPath << endl;
+
+    while (true)
+    {
+        int descriptor = accept(listener, nullptr, nullptr);
+        if (descriptor < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            cerr << "Could not accept connection." << endl;
+            break;
+        }
+        thread(serve, ref(automata), descriptor).detach();
+    }
+    close(listener);
+    return 0;
+}
@@ -0,0 +1,288 @@
+#pragma once
+
+#include <map>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+#include <stdexcept>
+#include <string_view>
+#include "fa.hpp"
+
+using namespace std;
+
+namespace fa
+{
+    // DFA over code points where every transition covers an interval [low, high], so "any letter"
+    // is a handful of ranges instead of thousands of edges
+    class RangeDFA
+    {
+    public:
+        struct Range
+        {
+            uint32_t low, high;
+            int target;
+        };
+
+        static const uint32_t maximumCodePoint = 0x10FFFF;
+
+    private:
+        int initialState = 0;
+        // per state, sorted by low and pairwise disjoint so lookups are a binary search
+        vector<vector<Range>> ranges;
+        vector<char> finalStates;
+
+        static void encodeUTF8(uint32_t codePoint, vector<uint8_t> &bytes)
+        {
+            bytes.clear();
+            if (codePoint < 0x80)
+                bytes.push_back(codePoint);
+            else if (codePoint < 0x800)
+            {
+                bytes.push_back(0xC0 | (codePoint >> 6));
+                bytes.push_back(0x80 | (codePoint & 0x3F));
+            }
+            else if (codePoint < 0x10000)
+            {
+                bytes.push_back(0xE0 | (codePoint >> 12));
+                bytes.push_back(0x80 | ((codePoint >> 6) & 0x3F));
+                bytes.push_back(0x80 | (codePoint & 0x3F));
+            }
+            else
+            {
+                bytes.push_back(0xF0 | (codePoint >> 18));
+                bytes.push_back(0x80 | ((codePoint >> 12) & 0x3F));
+                bytes.push_back(0x80 | ((codePoint >> 6) & 0x3F));
+                bytes.push_back(0x80 | (codePoint & 0x3F));
+            }
+        }
+
+        // splits [low, high] into sequences of byte ranges whose products are exactly the UTF-8 encodings
+        // of the interval: first by encoded length, then until all code points share their leading bytes
+        // and only the trailing bytes vary over whole continuation ranges
+        static void splitUTF8(uint32_t low, uint32_t high, vector<vector<pair<uint8_t, uint8_t>>> &sequences)
+        {
+            if (low > high)
+                return;
+            // surrogates have no encoding
+            if (low < 0xE000 && high > 0xD7FF)
+            {
+                splitUTF8(low, min(high, (uint32_t)0xD7FF), sequences);
+                splitUTF8(max(low, (uint32_t)0xE000), high, sequences);
+                return;
+            }
+            for (uint32_t lengthEnd : {0x7Fu, 0x7FFu, 0xFFFFu})
+                if (low <= lengthEnd && high > lengthEnd)
+                {
+                    splitUTF8(low, lengthEnd, sequences);
+                    splitUTF8(lengthEnd + 1, high, sequences);
+                    return;
+                }
+            for (int continuationBytes = 1; continuationBytes <= 3; continuationBytes++)
+            {
+                uint32_t mask = (1u << (6 * continuationBytes)) - 1;
+                if ((low & ~mask) == (high & ~mask))
+                    continue;
+                if ((low & mask) != 0)
+                {
+                    splitUTF8(low, low | mask, sequences);
+                    splitUTF8((low | mask) + 1, high, sequences);
+                    return;
+                }
+                if ((high & mask) != mask)
+                {
+                    splitUTF8(low, (high & ~mask) - 1, sequences);
+                    splitUTF8(high & ~mask, high, sequences);
+                    return;
+                }
+            }
+
+            vector<uint8_t> lowBytes, highBytes;
+            encodeUTF8(low, lowBytes);
+            encodeUTF8(high, highBytes);
+            vector<pair<uint8_t, uint8_t>> sequence;
+            for (size_t index = 0; index < lowBytes.size(); index++)
+                sequence.emplace_back(lowBytes[index], highBytes[index]);
+            sequences.push_back(sequence);
+        }
+
+    public:
+        int addState()
+        {
+            ranges.emplace_back();
+            finalStates.push_back(0);
+            return ranges.size() - 1;
+        }
+
+        void addFinalState(int state) { finalStates.at(state) = 1; }
+        void setInitialState(int state) { initialState = state; }
+
+        void addRange(int state, uint32_t low, uint32_t high, int target)
+        {
+            if (low > high || high > maximumCodePoint)
+                throw(runtime_error("Invalid code point range."));
+            if (target < 0 || target >= (int)ranges.size())
+                throw(runtime_error("Could not find target state."));
+            vector<Range> &stateRanges = ranges.at(state);
+            auto itr = upper_bound(stateRanges.begin(), stateRanges.end(), low, [](uint32_t codePoint, const Range &range)
+                                   { return codePoint < range.low; });
+            if ((itr != stateRanges.end() && itr->low <= high) || (itr != stateRanges.begin() && prev(itr)->high >= low))
+                throw(runtime_error("Automata is not deterministic."));
+            stateRanges.insert(itr, Range{low, high, target});
+        }
+
+        // -1 when no range of the state covers the code point
+        int getNextState(int state, uint32_t codePoint) const
+        {
+            const vector<Range> &stateRanges = ranges[state];
+            auto itr = upper_bound(stateRanges.begin(), stateRanges.end(), codePoint, [](uint32_t codePoint, const Range &range)
+                                   { return codePoint < range.low; });
+            if (itr == stateRanges.begin() || prev(itr)->high < codePoint)
+                return -1;
+            return prev(itr)->target;
+        }
+
+        bool evaluate(const u32string &str) const
+        {
+            int state = initialState;
+            for (size_t index = 0; index < str.size() && state != -1; index++)
+                state = getNextState(state, str[index]);
+            return state != -1 && finalStates[state];
+        }
+
+        // strict decoding, overlong forms, surrogates and truncated sequences reject the word
+        static bool decodeUTF8(string_view str, size_t &position, uint32_t &codePoint)
+        {
+            uint8_t lead = str[position++];
+            int continuationBytes = (lead < 0x80) ? 0 : (lead >= 0xC2 && lead < 0xE0) ? 1 : (lead >= 0xE0 && lead < 0xF0) ? 2 : (lead >= 0xF0 && lead < 0xF5) ? 3 : -1;
+            if (continuationBytes == -1 || position + continuationBytes > str.size())
+                return false;
+            codePoint = continuationBytes ? lead & (0x3F >> continuationBytes) : lead;
+            for (int index = 0; index < continuationBytes; index++)
+            {
+                uint8_t byte = str[position++];
+                if ((byte & 0xC0) != 0x80)
+                    return false;
+                codePoint = (codePoint << 6) | (byte & 0x3F);
+            }
+            static const uint32_t smallest[] = {0, 0x80, 0x800, 0x10000};
+            return codePoint >= smallest[continuationBytes] && codePoint <= maximumCodePoint && (codePoint < 0xD800 || codePoint > 0xDFFF);
+        }
+
+        bool evaluateUTF8(string_view str) const
+        {
+            int state = initialState;
+            size_t position = 0;
+            uint32_t codePoint;
+            while (position < str.size() && state != -1)
+            {
+                if (!decodeUTF8(str, position, codePoint))
+                    return false;
+                state = getNextState(state, codePoint);
+            }
+            return state != -1 && finalStates[state];
+        }
+
+        // byte level DFA accepting exactly the UTF-8 encodings of the accepted words, states keep their
+        // numbers and the bytes inside an encoding get fresh states, minimize() merges the shared suffixes
+        DFA toByteDFA() const
+        {
+            DFA automata;
+            // every byte can occur in the input, only the empty word stands for lambda
+            automata.setLambdaString(vector<char>());
+            int stateCount = ranges.size();
+            for (int state = 0; state < stateCount; state++)
+            {
+                automata.addState(state);
+                if (finalStates[state])
+                    automata.addFinalState(state);
+            }
+            automata.setInitialState(initialState);
+
+            int nextState = stateCount;
+            for (int state = 0; state < stateCount; state++)
+            {
+                vector<vector<pair<uint8_t, uint8_t>>> sequences;
+                vector<int> sequenceTargets;
+                for (const auto &range : ranges[state])
+                {
+                    splitUTF8(range.low, range.high, sequences);
+                    sequenceTargets.resize(sequences.size(), range.target);
+                }
+
+                // a node is the set of (sequence, depth) still alive after the bytes read from the state,
+                // nodes with the same set are shared so the trie stays deterministic and small
+                typedef vector<pair<int, int>> Items;
+                map<Items, int> nodeEncoding;
+                vector<pair<int, Items>> pending;
+                Items start;
+                for (int sequence = 0; sequence < (int)sequences.size(); sequence++)
+                    start.emplace_back(sequence, 0);
+                pending.emplace_back(state, start);
+
+                while (!pending.empty())
+                {
+                    int node = pending.back().first;
+                    Items items = pending.back().second;
+                    pending.pop_back();
+
+                    // the byte ranges of the items cut [0, 255] into intervals every item covers entirely or not at all
+                    vector<int> bounds;
+                    for (const auto &item : items)
+                    {
+                        bounds.push_back(sequences[item.first][item.second].first);
+                        bounds.push_back(sequences[item.first][item.second].second + 1);
+                    }
+                    sort(bounds.begin(), bounds.end());
+                    bounds.erase(unique(bounds.begin(), bounds.end()), bounds.end());
+
+                    for (size_t bound = 0; bound + 1 < bounds.size(); bound++)
+                    {
+                        int firstByte = bounds[bound], lastByte = bounds[bound + 1] - 1;
+                        Items nextItems;
+                        int target = -1;
+                        for (const auto &item : items)
+                        {
+                            const auto &byteRange = sequences[item.first][item.second];
+                            if (byteRange.first > firstByte || byteRange.second < firstByte)
+                                continue;
+                            // UTF-8 is prefix free, a finished sequence is never a prefix of a longer one
+                            if (item.second + 1 == (int)sequences[item.first].size())
+                                target = sequenceTargets[item.first];
+                            else
+                                nextItems.emplace_back(item.first, item.second + 1);
+                        }
+                        if (target == -1 && nextItems.empty())
+                            continue;
+                        if (target == -1)
+                        {
+                            auto itn = nodeEncoding.find(nextItems);
+                            if (itn == nodeEncoding.end())
+                            {
+                                itn = nodeEncoding.insert(make_pair(nextItems, nextState)).first;
+                                automata.addState(nextState++);
+                                pending.emplace_back(itn->second, nextItems);
+                            }
+                            target = itn->second;
+                        }
+                        for (int byte = firstByte; byte <= lastByte; byte++)
+                            automata.addTransition(node, target, (char)byte);
+                    }
+                }
+            }
+            return automata;
+        }
+
+        int getStateCount() const { return ranges.size(); }
+        int getInitialState() const { return initialState; }
+        bool isFinalState(int state) const { return finalStates[state]; }
+        const vector<Range> &getRanges(int state) const { return ranges[state]; }
+        size_t getRangeCount() const
+        {
+            size_t count = 0;
+            for (const auto &stateRanges : ranges)
+                count += stateRanges.size();
+            return count;
+        }
+    };
+};
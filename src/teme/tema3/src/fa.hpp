@@ -1,21 +1,300 @@
+#pragma once
+
 #include <set>
 #include <map>
+#include <array>
 #include <stack>
 #include <queue>
+#include <vector>
+#include <cstdint>
+#include <limits>
 #include <iostream>
 #include <algorithm>
+#include <type_traits>
 
 using namespace std;
 
 namespace fa {
+    template<typename SymbolType>
+    struct ParseTree {
+        SymbolType symbol;
+        // children are empty for a leaf, which then carries the terminal it derives
+        SymbolType terminal{};
+        vector<ParseTree> children;
+
+        friend ostream &operator<<(ostream &out, const ParseTree &tree) {
+            out << "(" << tree.symbol << " ";
+            if (tree.children.empty())
+                out << tree.terminal;
+            else
+                for (const auto &child: tree.children)
+                    out << child;
+            return out << ")";
+        }
+    };
+
+    // shared packed parse forest of a CYK chart: one symbol node per (symbol, start, size) that derives
+    // the segment, one packed node per way of deriving it, so every tree is a choice of packed nodes
+    // and the whole forest stays O(n^3) even when the number of trees is exponential
+    template<typename SymbolType>
+    class ParseForest {
+    public:
+        struct SymbolNode {
+            SymbolType symbol;
+            int start, size;
+            // head of the list of packed nodes
+            int firstPacked;
+        };
+
+        // left and right are symbol nodes, both are -1 for a leaf rule on the terminal at start
+        struct PackedNode {
+            int left, right;
+            int next;
+        };
+
+    private:
+        // both arenas only grow while the chart is filled and nodes refer to each other by index,
+        // children are always created before their parents
+        vector<SymbolNode> symbolNodes;
+        vector<PackedNode> packedNodes;
+        vector<SymbolType> str;
+        int root = -1;
+
+        ParseTree<SymbolType> extract(int node) const {
+            const SymbolNode &symbolNode = symbolNodes[node];
+            const PackedNode &packedNode = packedNodes[symbolNode.firstPacked];
+            ParseTree<SymbolType> tree{symbolNode.symbol, SymbolType{}, {}};
+            if (packedNode.left == -1)
+                tree.terminal = str[symbolNode.start];
+            else {
+                tree.children.push_back(extract(packedNode.left));
+                tree.children.push_back(extract(packedNode.right));
+            }
+            return tree;
+        }
+
+    public:
+        explicit ParseForest(const vector<SymbolType> &str) : str(str) {}
+
+        int addSymbolNode(SymbolType symbol, int start, int size) {
+            symbolNodes.push_back(SymbolNode{symbol, start, size, -1});
+            return symbolNodes.size() - 1;
+        }
+
+        void addPackedNode(int node, int left, int right) {
+            packedNodes.push_back(PackedNode{left, right, symbolNodes[node].firstPacked});
+            symbolNodes[node].firstPacked = packedNodes.size() - 1;
+        }
+
+        void setRoot(int node) { root = node; }
+        int getRoot() const { return root; }
+        bool empty() const { return root == -1; }
+
+        const SymbolNode &getSymbolNode(int node) const { return symbolNodes[node]; }
+        const PackedNode &getPackedNode(int packed) const { return packedNodes[packed]; }
+        size_t getSymbolNodeCount() const { return symbolNodes.size(); }
+        size_t getPackedNodeCount() const { return packedNodes.size(); }
+
+        // only walks the first packed node of every symbol node on the way down, O(n) nodes
+        ParseTree<SymbolType> getFirstTree() const {
+            if (empty())
+                throw (logic_error("The string has no parse tree!"));
+            return extract(root);
+        }
+
+        // trees below every node in creation order, saturates instead of overflowing
+        uint64_t countTrees() const {
+            if (empty())
+                return 0;
+            const uint64_t limit = numeric_limits<uint64_t>::max();
+            vector<uint64_t> treeCount(symbolNodes.size(), 0);
+            for (int node = 0; node <= root; node++)
+                for (int packed = symbolNodes[node].firstPacked; packed != -1; packed = packedNodes[packed].next) {
+                    const PackedNode &packedNode = packedNodes[packed];
+                    uint64_t count = 1;
+                    if (packedNode.left != -1) {
+                        uint64_t left = treeCount[packedNode.left], right = treeCount[packedNode.right];
+                        count = (left != 0 && right > limit / left) ? limit : left * right;
+                    }
+                    treeCount[node] = (treeCount[node] > limit - count) ? limit : treeCount[node] + count;
+                }
+            return treeCount[root];
+        }
+    };
+
+    template<typename SymbolType>
+    class IncrementalCYK;
+
     template<typename SymbolType>
     class CNFAutomata {
+        friend class IncrementalCYK<SymbolType>;
+
     private:
         SymbolType emptySymbol, startSymbol;
         set<SymbolType> symbols;
         map<SymbolType, set<SymbolType>> parentOfSymbol;
         map<pair<SymbolType, SymbolType>, set<SymbolType>> parentOfSymbols;
 
+        // filled at load time: the nonterminals left after pruning, numbered densely with the most used
+        // first, so a chart cell is a bitmask of maskWords words and the hot symbols share the first one
+        vector<SymbolType> nonterminals;
+        int maskWords = 1;
+        int encodedStartSymbol = -1;
+        // terminal -> mask of the nonterminals producing it, byte sized symbols skip the map
+        map<SymbolType, int> terminalEncoding;
+        array<int, 256> byteTerminals;
+        vector<uint64_t> terminalMasks;
+        // binary rules by left child B: entries [ruleOffsets[B], ruleOffsets[B + 1]) hold a right child C and
+        // the mask of the parents of B C, rightChildren[B] masks every such C
+        vector<uint32_t> ruleOffsets;
+        vector<int> ruleRights;
+        vector<uint64_t> ruleParents;
+        vector<uint64_t> rightChildren;
+        // every nonterminal occurring as a left, respectively right, child
+        vector<uint64_t> leftMask, rightMask;
+
+        static int lowestBit(uint64_t mask) {
+#if defined(__GNUC__) || defined(__clang__)
+            return __builtin_ctzll(mask);
+#else
+            int bit = 0;
+            for (; !(mask & 1); mask >>= 1)
+                bit++;
+            return bit;
+#endif
+        }
+
+        bool intersects(const uint64_t *first, const uint64_t *second) const {
+            for (int word = 0; word < maskWords; word++)
+                if (first[word] & second[word])
+                    return true;
+            return false;
+        }
+
+        // -1 for symbols no rule produces
+        int terminalIndex(const SymbolType &symbol) const {
+            if constexpr (is_integral_v<SymbolType> && sizeof(SymbolType) == 1)
+                return byteTerminals[(unsigned char) symbol];
+            else {
+                auto itt = terminalEncoding.find(symbol);
+                return itt != terminalEncoding.end() ? itt->second : -1;
+            }
+        }
+
+        // removes the symbols that can not take part in a derivation of the start symbol, those that derive
+        // no terminal string and those unreachable through rules of symbols that do, then builds the tables
+        void compile() {
+            set<SymbolType> generating;
+            for (const auto &entry: parentOfSymbol)
+                generating.insert(entry.second.begin(), entry.second.end());
+            for (bool changed = true; changed;) {
+                changed = false;
+                for (const auto &entry: parentOfSymbols)
+                    if (generating.count(entry.first.first) && generating.count(entry.first.second))
+                        for (const auto &symbol: entry.second)
+                            changed |= generating.insert(symbol).second;
+            }
+
+            map<SymbolType, vector<SymbolType>> children;
+            for (const auto &entry: parentOfSymbols)
+                if (generating.count(entry.first.first) && generating.count(entry.first.second))
+                    for (const auto &symbol: entry.second) {
+                        children[symbol].push_back(entry.first.first);
+                        children[symbol].push_back(entry.first.second);
+                    }
+            set<SymbolType> useful;
+            vector<SymbolType> pending;
+            if (generating.count(startSymbol)) {
+                useful.insert(startSymbol);
+                pending.push_back(startSymbol);
+            }
+            while (!pending.empty()) {
+                SymbolType symbol = pending.back();
+                pending.pop_back();
+                for (const auto &child: children[symbol])
+                    if (useful.insert(child).second)
+                        pending.push_back(child);
+            }
+
+            for (auto itp = parentOfSymbol.begin(); itp != parentOfSymbol.end();) {
+                for (auto its = itp->second.begin(); its != itp->second.end();)
+                    its = useful.count(*its) ? next(its) : itp->second.erase(its);
+                itp = itp->second.empty() ? parentOfSymbol.erase(itp) : next(itp);
+            }
+            for (auto itp = parentOfSymbols.begin(); itp != parentOfSymbols.end();) {
+                if (useful.count(itp->first.first) && useful.count(itp->first.second))
+                    for (auto its = itp->second.begin(); its != itp->second.end();)
+                        its = useful.count(*its) ? next(its) : itp->second.erase(its);
+                else
+                    itp->second.clear();
+                itp = itp->second.empty() ? parentOfSymbols.erase(itp) : next(itp);
+            }
+            for (auto its = symbols.begin(); its != symbols.end();)
+                its = (useful.count(*its) || *its == emptySymbol || *its == startSymbol) ? next(its) : symbols.erase(its);
+
+            map<SymbolType, int> usage;
+            for (const auto &entry: parentOfSymbol)
+                for (const auto &symbol: entry.second)
+                    usage[symbol]++;
+            for (const auto &entry: parentOfSymbols) {
+                usage[entry.first.first] += entry.second.size();
+                usage[entry.first.second] += entry.second.size();
+                for (const auto &symbol: entry.second)
+                    usage[symbol]++;
+            }
+            nonterminals.assign(useful.begin(), useful.end());
+            stable_sort(nonterminals.begin(), nonterminals.end(), [&usage](const SymbolType &left, const SymbolType &right) {
+                return usage[left] > usage[right];
+            });
+            map<SymbolType, int> encoding;
+            for (const auto &symbol: nonterminals)
+                encoding.insert(make_pair(symbol, encoding.size()));
+            maskWords = max<int>(1, (nonterminals.size() + 63) / 64);
+            encodedStartSymbol = encoding.count(startSymbol) ? encoding[startSymbol] : -1;
+            auto setBit = [this](vector<uint64_t> &masks, size_t mask, int symbol) {
+                masks[mask * maskWords + symbol / 64] |= uint64_t(1) << (symbol % 64);
+            };
+
+            terminalEncoding.clear();
+            byteTerminals.fill(-1);
+            terminalMasks.clear();
+            for (const auto &entry: parentOfSymbol) {
+                int terminal = terminalEncoding.size();
+                terminalEncoding.insert(make_pair(entry.first, terminal));
+                if constexpr (is_integral_v<SymbolType> && sizeof(SymbolType) == 1)
+                    byteTerminals[(unsigned char) entry.first] = terminal;
+                terminalMasks.resize(terminalMasks.size() + maskWords, 0);
+                for (const auto &symbol: entry.second)
+                    setBit(terminalMasks, terminal, encoding[symbol]);
+            }
+
+            vector<tuple<int, int, int>> rules;
+            for (const auto &entry: parentOfSymbols)
+                for (const auto &symbol: entry.second)
+                    rules.emplace_back(encoding[entry.first.first], encoding[entry.first.second], encoding[symbol]);
+            sort(rules.begin(), rules.end());
+            ruleOffsets.assign(nonterminals.size() + 1, 0);
+            ruleRights.clear();
+            ruleParents.clear();
+            rightChildren.assign(nonterminals.size() * maskWords, 0);
+            leftMask.assign(maskWords, 0);
+            rightMask.assign(maskWords, 0);
+            for (size_t rule = 0; rule < rules.size(); rule++) {
+                int left = get<0>(rules[rule]), right = get<1>(rules[rule]);
+                if (rule == 0 || left != get<0>(rules[rule - 1]) || right != get<1>(rules[rule - 1])) {
+                    ruleOffsets[left + 1]++;
+                    ruleRights.push_back(right);
+                    ruleParents.resize(ruleParents.size() + maskWords, 0);
+                }
+                setBit(ruleParents, ruleRights.size() - 1, get<2>(rules[rule]));
+                setBit(rightChildren, left, right);
+                setBit(leftMask, 0, left);
+                setBit(rightMask, 0, right);
+            }
+            for (size_t symbol = 0; symbol < nonterminals.size(); symbol++)
+                ruleOffsets[symbol + 1] += ruleOffsets[symbol];
+        }
+
     public:
         CNFAutomata(SymbolType emptySymbol, SymbolType startSymbol) : emptySymbol(emptySymbol),
                                                                       startSymbol(startSymbol) {
@@ -25,52 +304,102 @@ namespace fa {
 
         ~CNFAutomata() = default;
 
-        bool evaluate(const vector<SymbolType> &str) {
-            vector<vector<set<char>>> partitions;
+        // const so one grammar can be shared between threads. the chart holds one bitmask per segment and a
+        // split is skipped outright when no rule can join its left and right cells
+        bool evaluate(const vector<SymbolType> &str) const {
+            int length = str.size();
+            if (length == 0 || encodedStartSymbol == -1)
+                return false;
+
+            // segment (start, start + size - 1) at ((size - 1) * length + start) * maskWords
+            vector<uint64_t> chart((size_t) length * length * maskWords, 0);
+            auto cell = [&chart, length, this](int size, int start) {
+                return &chart[((size_t) (size - 1) * length + start) * maskWords];
+            };
+
+            for (int strIndex = 0; strIndex < length; strIndex++) {
+                int terminal = terminalIndex(str[strIndex]);
+                // no segment covering the symbol derives from anything, so neither does the word
+                if (terminal == -1)
+                    return false;
+                copy_n(terminalMasks.begin() + (size_t) terminal * maskWords, maskWords, cell(1, strIndex));
+            }
+
+            for (int partitionSize = 2; partitionSize <= length; partitionSize++)
+                for (int partitionStart = 0; partitionStart + partitionSize <= length; partitionStart++) {
+                    uint64_t *target = cell(partitionSize, partitionStart);
+                    for (int leftSegmentSize = 1; leftSegmentSize < partitionSize; leftSegmentSize++) {
+                        const uint64_t *left = cell(leftSegmentSize, partitionStart);
+                        const uint64_t *right = cell(partitionSize - leftSegmentSize, partitionStart + leftSegmentSize);
+                        if (!intersects(left, leftMask.data()) || !intersects(right, rightMask.data()))
+                            continue;
+                        for (int word = 0; word < maskWords; word++)
+                            for (uint64_t remaining = left[word] & leftMask[word]; remaining; remaining &= remaining - 1) {
+                                int leftSymbol = word * 64 + lowestBit(remaining);
+                                if (!intersects(right, &rightChildren[(size_t) leftSymbol * maskWords]))
+                                    continue;
+                                for (uint32_t rule = ruleOffsets[leftSymbol]; rule < ruleOffsets[leftSymbol + 1]; rule++)
+                                    if ((right[ruleRights[rule] / 64] >> (ruleRights[rule] % 64)) & 1)
+                                        for (int parentWord = 0; parentWord < maskWords; parentWord++)
+                                            target[parentWord] |= ruleParents[(size_t) rule * maskWords + parentWord];
+                            }
+                    }
+                }
 
-            partitions.resize(str.size() + 2);
-            for (int lineIndex = 0; lineIndex <= str.size(); lineIndex++)
-                partitions[lineIndex].resize(str.size() + 2);
+            return (cell(length, 0)[encodedStartSymbol / 64] >> (encodedStartSymbol % 64)) & 1;
+        }
 
-            for (int strIndex = 0; strIndex < str.size(); strIndex++)
-                partitions[1][strIndex] = parentOfSymbol[str[strIndex]];
+        int getNonterminalCount() const { return nonterminals.size(); }
+
+        // same chart as evaluate, every cell maps its symbols to forest nodes so each derivation
+        // of a symbol over a segment becomes a packed node instead of being thrown away
+        ParseForest<SymbolType> parse(const vector<SymbolType> &str) const {
+            ParseForest<SymbolType> forest(str);
+            int length = str.size();
+            vector<vector<map<SymbolType, int>>> partitions(length + 1, vector<map<SymbolType, int>>(length));
+
+            for (int strIndex = 0; strIndex < length; strIndex++) {
+                auto itp = parentOfSymbol.find(str[strIndex]);
+                if (itp != parentOfSymbol.end())
+                    for (const auto &symbol: itp->second) {
+                        int node = forest.addSymbolNode(symbol, strIndex, 1);
+                        forest.addPackedNode(node, -1, -1);
+                        partitions[1][strIndex].insert(make_pair(symbol, node));
+                    }
+            }
 
-            for (int partitionSize = 2; partitionSize <= str.size(); partitionSize++)
-                for (int partitionStart = 0; partitionStart + partitionSize - 1 < str.size(); partitionStart++) {
+            for (int partitionSize = 2; partitionSize <= length; partitionSize++)
+                for (int partitionStart = 0; partitionStart + partitionSize - 1 < length; partitionStart++) {
                     int partitionEnd = partitionStart + partitionSize - 1;
+                    auto &cell = partitions[partitionSize][partitionStart];
                     for (int delimiterPosition = partitionStart;
                          delimiterPosition <= partitionEnd - 1; delimiterPosition++) {
-                        int leftSegmentSize =
-                                delimiterPosition - partitionStart + 1; // (partitionStart, delimiterPosition)
-                        int rightSegmentSize =
-                                partitionEnd - delimiterPosition; // (delimiterPosition + 1, partitionEnd)
+                        int leftSegmentSize = delimiterPosition - partitionStart + 1;
+                        int rightSegmentSize = partitionEnd - delimiterPosition;
 
                         for (const auto &leftSegmentSymbol: partitions[leftSegmentSize][partitionStart])
-                            for (const auto &rightSegmentSymbol: partitions[rightSegmentSize][delimiterPosition + 1])
-                                if (parentOfSymbols.find(
-                                        pair<SymbolType, SymbolType>(leftSegmentSymbol, rightSegmentSymbol)) !=
-                                    parentOfSymbols.end())
-                                    for (const auto &symbol: parentOfSymbols[pair<SymbolType, SymbolType>(
-                                            leftSegmentSymbol,
-                                            rightSegmentSymbol)])
-                                        partitions[partitionSize][partitionStart].insert(symbol);
+                            for (const auto &rightSegmentSymbol: partitions[rightSegmentSize][delimiterPosition + 1]) {
+                                auto itp = parentOfSymbols.find(
+                                        pair<SymbolType, SymbolType>(leftSegmentSymbol.first, rightSegmentSymbol.first));
+                                if (itp == parentOfSymbols.end())
+                                    continue;
+                                for (const auto &symbol: itp->second) {
+                                    auto itc = cell.find(symbol);
+                                    if (itc == cell.end())
+                                        itc = cell.insert(make_pair(symbol, forest.addSymbolNode(symbol, partitionStart,
+                                                                                                 partitionSize))).first;
+                                    forest.addPackedNode(itc->second, leftSegmentSymbol.second, rightSegmentSymbol.second);
+                                }
+                            }
                     }
                 }
 
-//            for (int lineIndex = 1; lineIndex <= str.size(); lineIndex++) {
-//                for (int columnIndex = 0; columnIndex < str.size(); columnIndex++) {
-//                    if (partitions[lineIndex][columnIndex].empty())
-//                        cout << "NULL";
-//                    else {
-//                        for (const auto &partition: partitions[lineIndex][columnIndex])
-//                            cout << partition << ",";
-//                    }
-//                    cout << " ";
-//                }
-//                cout << endl;
-//            }
-
-            return (partitions[str.size()][0].find(startSymbol) != partitions[str.size()][0].end());
+            if (!str.empty()) {
+                auto itr = partitions[length][0].find(startSymbol);
+                if (itr != partitions[length][0].end())
+                    forest.setRoot(itr->second);
+            }
+            return forest;
         }
 
         friend istream &operator>>(istream &in, CNFAutomata &automata) {
@@ -102,6 +431,7 @@ namespace fa {
                 }
             }
 
+            automata.compile();
             return in;
         }
 
@@ -127,6 +457,81 @@ namespace fa {
         }
     };
 
+    // CYK chart kept by end position: appending a symbol only fills the column of segments ending in it,
+    // O(n^2) work instead of rebuilding the O(n^3) chart, and popping drops that column again
+    template<typename SymbolType>
+    class IncrementalCYK {
+    private:
+        const CNFAutomata<SymbolType> &automata;
+        // columns[end][start] holds the symbols deriving the segment (start, end)
+        vector<vector<set<SymbolType>>> columns;
+
+    public:
+        explicit IncrementalCYK(const CNFAutomata<SymbolType> &automata) : automata(automata) {}
+
+        void push(const SymbolType &symbol) {
+            int end = columns.size();
+            columns.emplace_back(end + 1);
+            auto &column = columns.back();
+
+            auto itp = automata.parentOfSymbol.find(symbol);
+            if (itp != automata.parentOfSymbol.end())
+                column[end] = itp->second;
+
+            // shorter segments first, (start, end) splits into (start, delimiter) and (delimiter + 1, end)
+            for (int start = end - 1; start >= 0; start--)
+                for (int delimiterPosition = start; delimiterPosition < end; delimiterPosition++)
+                    for (const auto &leftSegmentSymbol: columns[delimiterPosition][start])
+                        for (const auto &rightSegmentSymbol: column[delimiterPosition + 1]) {
+                            auto itr = automata.parentOfSymbols.find(
+                                    pair<SymbolType, SymbolType>(leftSegmentSymbol, rightSegmentSymbol));
+                            if (itr != automata.parentOfSymbols.end())
+                                column[start].insert(itr->second.begin(), itr->second.end());
+                        }
+        }
+
+        void pop() {
+            if (columns.empty())
+                throw (logic_error("Nothing to pop!"));
+            columns.pop_back();
+        }
+
+        void clear() { columns.clear(); }
+        size_t size() const { return columns.size(); }
+
+        // whether the symbols pushed so far form a word of the grammar
+        bool accepts() const {
+            return !columns.empty() && columns.back()[0].find(automata.startSymbol) != columns.back()[0].end();
+        }
+
+        // words are visited in lexicographic order, the trie order, so consecutive words only pop and
+        // push the symbols after their common prefix
+        vector<bool> evaluateBatch(const vector<vector<SymbolType>> &words) {
+            vector<int> order(words.size());
+            for (int wordIndex = 0; wordIndex < words.size(); wordIndex++)
+                order[wordIndex] = wordIndex;
+            sort(order.begin(), order.end(), [&words](int left, int right) { return words[left] < words[right]; });
+
+            vector<bool> answers(words.size());
+            vector<SymbolType> current;
+            clear();
+            for (auto wordIndex: order) {
+                const auto &word = words[wordIndex];
+                size_t common = mismatch(current.begin(), current.end(), word.begin(), word.end()).first - current.begin();
+                while (current.size() > common) {
+                    current.pop_back();
+                    pop();
+                }
+                for (size_t symbolIndex = common; symbolIndex < word.size(); symbolIndex++) {
+                    current.push_back(word[symbolIndex]);
+                    push(word[symbolIndex]);
+                }
+                answers[wordIndex] = accepts();
+            }
+            return answers;
+        }
+    };
+
     template<typename StateType, typename SymbolType>
     class PushdownAutomata {
     private:
@@ -138,35 +543,214 @@ namespace fa {
         set<StateType> finalStates;
         SymbolType lambdaSymbol, startSymbol;
 
-        void DFS(int currentState, const vector<SymbolType> &str, int strIndex, stack<SymbolType> &stack, bool &answer,
-                 bool previousIsLambda, int firstLambda) {
+        // states that can not reach a final state whatever the stack holds, filled at load time
+        set<StateType> deadStates;
+        // filled at load time when no two transitions can ever apply to the same configuration
+        bool deterministic = false;
+        map<StateType, int> stateEncoding;
+        map<SymbolType, int> symbolEncoding;
+        // (state, input symbol or lambda, stack top or empty stack) -> transition, -1 when there is none
+        vector<int> table;
+        vector<char> finalTable;
+        int encodedInitialState = 0;
+        // per transition: target, encoded pop symbol or -1, pushed symbols [pushOffsets[i], pushOffsets[i + 1])
+        // stored bottom to top so they can be appended to the stack as they are
+        vector<int> transitionTargets, transitionPops, pushOffsets, pushSymbols;
+
+        int tableIndex(int state, int input, int top) const {
+            int width = symbolEncoding.size() + 1;
+            return (state * width + input) * width + top;
+        }
+
+        // the first pushed symbol ends up on top, lambda in the push list stands for pushing nothing
+        void applyPush(stack<SymbolType> &stack, const vector<SymbolType> &push) const {
+            for (auto its = push.rbegin(); its != push.rend(); its++)
+                if (*its != lambdaSymbol)
+                    stack.push(*its);
+        }
+
+        void DFS(StateType currentState, const vector<SymbolType> &str, size_t strIndex, stack<SymbolType> &stack,
+                 bool &answer, size_t lambdaMoves) const {
             if (strIndex == str.size() && finalStates.find(currentState) != finalStates.end()) {
                 answer = true;
                 return;
             }
 
-            for (const auto &nextState: transitions[currentState])
+            auto itt = transitions.find(currentState);
+            if (itt == transitions.end())
+                return;
+            for (const auto &nextState: itt->second) {
+                if (deadStates.find(nextState.first) != deadStates.end())
+                    continue;
                 for (const auto &transition: nextState.second) {
                     if (answer)
                         return;
-                    if (previousIsLambda && nextState.first == firstLambda)
+                    bool isLambda = get<0>(transition) == lambdaSymbol;
+                    // a longer run of lambda moves than there are (state, stack top) pairs is treated as a cycle
+                    if (isLambda && lambdaMoves > states.size() * symbols.size())
                         continue;
-                    if ((get<0>(transition) == lambdaSymbol || get<0>(transition) == str[strIndex])
-                        && (get<1>(transition) == lambdaSymbol || (!stack.empty() && stack.top() == str[strIndex]))) {
-                        if(get<1>(transition) == lambdaSymbol)
-                            stack.pop();
-                        for(const auto& pushState: get<2>(transition))
-                            stack.push(pushState);
-                        if(get<0>(transition) != lambdaSymbol)
-                            DFS(nextState.first, str, strIndex + 1, stack, answer, false, -1);
-                        else {
-                            if(previousIsLambda)
-                                DFS(nextState.first, str, strIndex, stack, answer, true, currentState);
-                            else
-                                DFS(nextState.first, str, strIndex, stack, answer, true, firstLambda);
-                        }
+                    if (!isLambda && (strIndex == str.size() || get<0>(transition) != str[strIndex]))
+                        continue;
+                    if (get<1>(transition) != lambdaSymbol && (stack.empty() || stack.top() != get<1>(transition)))
+                        continue;
+
+                    auto saved = stack;
+                    if (get<1>(transition) != lambdaSymbol)
+                        stack.pop();
+                    applyPush(stack, get<2>(transition));
+                    DFS(nextState.first, str, strIndex + !isLambda, stack, answer, isLambda ? lambdaMoves + 1 : 0);
+                    stack = saved;
+                }
+            }
+        }
+
+        // co-reachability on the state graph alone, ignoring the stack only ever keeps too many states alive
+        void computeDeadStates() {
+            map<StateType, vector<StateType>> predecessors;
+            for (const auto &line: transitions)
+                for (const auto &column: line.second)
+                    predecessors[column.first].push_back(line.first);
+
+            set<StateType> coReachable(finalStates.begin(), finalStates.end());
+            vector<StateType> stateStack(finalStates.begin(), finalStates.end());
+            while (!stateStack.empty()) {
+                StateType state = stateStack.back();
+                stateStack.pop_back();
+                for (const auto &predecessor: predecessors[state])
+                    if (coReachable.insert(predecessor).second)
+                        stateStack.push_back(predecessor);
+            }
+
+            deadStates.clear();
+            for (const auto &encoding: stateEncoding)
+                if (coReachable.find(encoding.first) == coReachable.end())
+                    deadStates.insert(encoding.first);
+        }
+
+        // builds the dense table and decides determinism: every (state, input, top) cell may hold one transition,
+        // and a lambda move on (state, top) rules out every input move on the same (state, top)
+        void compile() {
+            stateEncoding.clear();
+            symbolEncoding.clear();
+            for (const auto &state: states)
+                stateEncoding.insert(make_pair(state, stateEncoding.size()));
+            for (const auto &line: transitions) {
+                stateEncoding.insert(make_pair(line.first, stateEncoding.size()));
+                for (const auto &column: line.second)
+                    stateEncoding.insert(make_pair(column.first, stateEncoding.size()));
+            }
+            stateEncoding.insert(make_pair(initialState, stateEncoding.size()));
+            computeDeadStates();
+
+            auto encodeSymbol = [this](const SymbolType &symbol) {
+                if (symbol != lambdaSymbol)
+                    symbolEncoding.insert(make_pair(symbol, symbolEncoding.size()));
+            };
+            for (const auto &symbol: symbols)
+                encodeSymbol(symbol);
+            for (const auto &line: transitions)
+                for (const auto &column: line.second)
+                    for (const auto &transition: column.second) {
+                        encodeSymbol(get<0>(transition));
+                        encodeSymbol(get<1>(transition));
+                        for (const auto &symbol: get<2>(transition))
+                            encodeSymbol(symbol);
+                    }
+
+            int width = symbolEncoding.size() + 1, lambdaIndex = symbolEncoding.size();
+            table.assign(stateEncoding.size() * width * width, -1);
+            finalTable.assign(stateEncoding.size(), 0);
+            for (const auto &finalState: finalStates)
+                if (stateEncoding.find(finalState) != stateEncoding.end())
+                    finalTable[stateEncoding[finalState]] = 1;
+            encodedInitialState = stateEncoding[initialState];
+            transitionTargets.clear();
+            transitionPops.clear();
+            pushOffsets.assign(1, 0);
+            pushSymbols.clear();
+
+            deterministic = true;
+            for (const auto &line: transitions)
+                for (const auto &column: line.second)
+                    for (const auto &transition: column.second) {
+                        // moves into dead states are left out of the table, the run rejects right there
+                        if (deadStates.find(column.first) != deadStates.end())
+                            continue;
+                        int transitionIndex = transitionTargets.size();
+                        int state = stateEncoding[line.first];
+                        int input = get<0>(transition) == lambdaSymbol ? lambdaIndex : symbolEncoding[get<0>(transition)];
+                        int pop = get<1>(transition) == lambdaSymbol ? -1 : symbolEncoding[get<1>(transition)];
+                        transitionTargets.push_back(stateEncoding[column.first]);
+                        transitionPops.push_back(pop);
+                        for (auto its = get<2>(transition).rbegin(); its != get<2>(transition).rend(); its++)
+                            if (*its != lambdaSymbol)
+                                pushSymbols.push_back(symbolEncoding[*its]);
+                        pushOffsets.push_back(pushSymbols.size());
+
+                        // a transition that pops nothing applies whatever the top is, even on an empty stack
+                        for (int top = 0; top < width; top++)
+                            if (pop == -1 || pop == top) {
+                                int &cell = table[tableIndex(state, input, top)];
+                                if (cell != -1)
+                                    deterministic = false;
+                                cell = transitionIndex;
+                            }
                     }
+
+            for (int state = 0; state < (int)stateEncoding.size() && deterministic; state++)
+                for (int top = 0; top < width && deterministic; top++)
+                    if (table[tableIndex(state, lambdaIndex, top)] != -1)
+                        for (int input = 0; input < lambdaIndex; input++)
+                            if (table[tableIndex(state, input, top)] != -1)
+                                deterministic = false;
+        }
+
+        // single pass over the word, at most one transition applies in every configuration
+        bool evaluateDeterministic(const vector<SymbolType> &str) const {
+            int width = symbolEncoding.size() + 1, lambdaIndex = symbolEncoding.size();
+            // a run of lambda moves that keeps the stack at least this high and is longer than the number of
+            // (state, top) pairs repeats a configuration and would loop forever
+            const size_t lambdaBound = stateEncoding.size() * width + 1;
+
+            vector<int> stack;
+            stack.reserve(str.size() + 16);
+            stack.push_back(symbolEncoding.at(startSymbol));
+            int currentState = encodedInitialState;
+            size_t strIndex = 0, lambdaMoves = 0, lambdaFloor = stack.size();
+
+            while (true) {
+                if (strIndex == str.size() && finalTable[currentState])
+                    return true;
+                int top = stack.empty() ? lambdaIndex : stack.back();
+                int transitionIndex = -1;
+                if (strIndex < str.size()) {
+                    auto its = symbolEncoding.find(str[strIndex]);
+                    if (its == symbolEncoding.end() || str[strIndex] == lambdaSymbol)
+                        return false;
+                    transitionIndex = table[tableIndex(currentState, its->second, top)];
+                }
+                if (transitionIndex != -1) {
+                    strIndex++;
+                    lambdaMoves = 0;
+                    lambdaFloor = stack.size();
+                } else {
+                    transitionIndex = table[tableIndex(currentState, lambdaIndex, top)];
+                    if (transitionIndex == -1)
+                        return false;
+                    if (++lambdaMoves > lambdaBound)
+                        return false;
+                }
+
+                if (transitionPops[transitionIndex] != -1)
+                    stack.pop_back();
+                if (stack.size() < lambdaFloor) {
+                    lambdaFloor = stack.size();
+                    lambdaMoves = 0;
                 }
+                stack.insert(stack.end(), pushSymbols.begin() + pushOffsets[transitionIndex],
+                             pushSymbols.begin() + pushOffsets[transitionIndex + 1]);
+                currentState = transitionTargets[transitionIndex];
+            }
         }
 
     public:
@@ -178,10 +762,18 @@ namespace fa {
 
         ~PushdownAutomata() = default;
 
-        bool evaluate(const vector<SymbolType> &str) {
+        bool isDeterministic() const { return deterministic; }
+
+        // the stack starts with the start symbol, deterministic automata skip the backtracking search
+        bool evaluate(const vector<SymbolType> &str) const {
+            if (deadStates.find(initialState) != deadStates.end())
+                return false;
+            if (deterministic)
+                return evaluateDeterministic(str);
             stack<SymbolType> stack;
+            stack.push(startSymbol);
             bool answer = false;
-            DFS(initialState, str, 0, stack, answer, false, -1);
+            DFS(initialState, str, 0, stack, answer, 0);
             return answer;
         }
 
@@ -222,18 +814,9 @@ namespace fa {
                     in >> symbol;
                     pushSymbols.push_back(symbol);
                 }
-                if (automata.transitions.find(startState) == automata.transitions.end())
-                    automata.transitions.insert(make_pair(startState, map < StateType, set <
-                                                                                       tuple<SymbolType, SymbolType, vector<SymbolType>>
-                                                                                               >> ()));
-                if (automata.transitions[startState].find(endState) == automata.transitions[endState].end())
-                    automata.transitions[startState].insert(make_pair(endState, set <
-                                                                                tuple<SymbolType, SymbolType, vector<SymbolType>> >
-                                                                                {make_tuple(matchSymbol, popSymbol,
-                                                                                            pushSymbols)}));
-                else
-                    automata.transitions[startState][endState].insert(make_tuple(matchSymbol, popSymbol, pushSymbols));
+                automata.transitions[startState][endState].insert(make_tuple(matchSymbol, popSymbol, pushSymbols));
             }
+            automata.compile();
             return in;
         }
 
@@ -16,23 +16,31 @@ int main() {
     PushdownAutomata<int, char> pushdownAutomata('0', '$');
     pdaIn >> pushdownAutomata;
     cout << "Pushdown Automata: " << pushdownAutomata << endl;
+    cout << "Deterministic: " << pushdownAutomata.isDeterministic() << endl;
 
     string input;
     int operationType;
 
     cout << "Evaluate string with CYK using CNF automata - 0" << endl;
     cout << "Evaluate string with pushdown Automata - 1" << endl;
+    cout << "Parse string with CYK using CNF automata - 2" << endl;
     cin >> operationType;
 
     cout << "String: " << endl;
     cin >> input;
 
-    if (operationType != 1 && operationType != 0)
+    if (operationType != 1 && operationType != 0 && operationType != 2)
         return 0;
 
     if (operationType == 0)
         cout << cnfAutomata.evaluate(vector<char>(input.begin(), input.end()));
-    else
+    else if (operationType == 1)
         cout << pushdownAutomata.evaluate(vector<char>(input.begin(), input.end()));
+    else {
+        ParseForest<char> forest = cnfAutomata.parse(vector<char>(input.begin(), input.end()));
+        cout << "Parse trees: " << forest.countTrees() << endl;
+        if (!forest.empty())
+            cout << forest.getFirstTree() << endl;
+    }
     return 0;
 }
\ No newline at end of file